@@ -0,0 +1,357 @@
+//
+// Copyright (c) 2022 Bjørn Fuglestad, Jaersense AS (bjorn@jaersense.no)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/bjorn-jaes/jay
+//
+
+/*
+ * End-to-end latency and throughput of the J1939 connections
+ *
+ * A connection on the tx interface sends frames stamped with the send time, they are
+ * forwarded to the rx interface by a bridge and read by a connection on the rx interface.
+ * The bridge is a thread in this process copying frames between two raw CAN sockets,
+ * or the kernel CAN gateway if --gateway is passed, which must be set up beforehand:
+ *
+ * sudo modprobe can-gw
+ * sudo cangw -A -s vcan0 -d vcan1 -e
+ *
+ * --window frames are sent at the start and every received frame sends a new one, so at
+ * most --window frames are in flight, the tx queue never grows unbounded and frames/s is
+ * the sustained throughput of the whole path. Results are written as
+ * a single json object so that runs can be compared between versions and machines.
+ *
+ * Usage:
+ * jay_bridge_benchmark [--mode asio|uring] [--tx vcan0] [--rx vcan1] [--duration 10]
+ *   [--warmup 1] [--window 64] [--gateway] [--out results.json]
+ */
+
+// C++
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+
+// Linux
+#include <linux/can.h>
+#include <net/if.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Libraries
+#include "boost/asio/io_context.hpp"
+#include "boost/asio/steady_timer.hpp"
+
+#include "../include/jay/network.hpp"
+#include "../include/jay/stage_histogram.hpp"
+
+// Local
+#include "j1939_connection.hpp"
+#ifdef JAY_HAS_IO_URING
+#include "j1939_uring_connection.hpp"
+#endif
+
+namespace {
+
+struct arguments
+{
+  std::string mode{ "asio" };
+  std::string tx{ "vcan0" };
+  std::string rx{ "vcan1" };
+  std::chrono::seconds duration{ 10 };
+  std::chrono::seconds warmup{ 1 };
+  std::uint64_t window{ 64 };
+  bool gateway{ false };
+  std::string out{};
+};
+
+struct results
+{
+  std::uint64_t frames_sent{};
+  std::uint64_t frames_received{};
+  std::chrono::nanoseconds elapsed{};
+  std::chrono::nanoseconds cpu{};
+  std::uint64_t kernel_drops{};
+  jay::latency_histogram latency{};
+};
+
+std::chrono::nanoseconds now() { return std::chrono::steady_clock::now().time_since_epoch(); }
+
+std::chrono::nanoseconds cpu_time(int who)
+{
+  rusage usage{};
+  getrusage(who, &usage);
+  auto to_ns = [](timeval time) {
+    return std::chrono::seconds{ time.tv_sec } + std::chrono::microseconds{ time.tv_usec };
+  };
+  return to_ns(usage.ru_utime) + to_ns(usage.ru_stime);
+}
+
+/**
+ * @brief Open a raw CAN socket bound to an interface
+ * @return socket or -1 on failure
+ */
+int open_raw(const std::string &interface)
+{
+  auto fd = ::socket(PF_CAN, SOCK_RAW | SOCK_CLOEXEC, CAN_RAW);
+  if (fd < 0) { return -1; }
+
+  sockaddr_can address{};
+  address.can_family = AF_CAN;
+  address.can_ifindex = static_cast<int>(if_nametoindex(interface.c_str()));
+  if (address.can_ifindex == 0 || ::bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0) {
+    ::close(fd);
+    return -1;
+  }
+
+  // Wake up periodically so that the bridge can be stopped
+  timeval timeout{ 0, 100'000 };
+  ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  return fd;
+}
+
+/**
+ * @brief User space bridge copying frames from one interface to another
+ */
+class bridge
+{
+public:
+  bool start(const std::string &from, const std::string &to)
+  {
+    from_ = open_raw(from);
+    to_ = open_raw(to);
+    if (from_ < 0 || to_ < 0) { return false; }
+
+    thread_ = std::thread([this] {
+      can_frame frame{};
+      while (running_.load(std::memory_order_relaxed)) {
+        if (::read(from_, &frame, sizeof(frame)) != sizeof(frame)) { continue; }
+        while (::write(to_, &frame, sizeof(frame)) < 0 && errno == ENOBUFS) { std::this_thread::yield(); }
+      }
+      cpu_ = cpu_time(RUSAGE_THREAD);
+    });
+    return true;
+  }
+
+  /**
+   * @brief Stop the bridge
+   * @return cpu time used by the bridge thread
+   */
+  std::chrono::nanoseconds stop()
+  {
+    running_ = false;
+    if (thread_.joinable()) { thread_.join(); }
+    return cpu_;
+  }
+
+  ~bridge()
+  {
+    stop();
+    if (from_ >= 0) { ::close(from_); }
+    if (to_ >= 0) { ::close(to_); }
+  }
+
+private:
+  int from_{ -1 };
+  int to_{ -1 };
+  std::atomic<bool> running_{ true };
+  std::thread thread_{};
+  std::chrono::nanoseconds cpu_{};
+};
+
+std::uint64_t kernel_drops(const J1939Connection &connection) { return connection.GetStats().kernel_drops; }
+
+#ifdef JAY_HAS_IO_URING
+std::uint64_t kernel_drops(const J1939UringConnection &connection) { return connection.KernelDrops(); }
+#endif
+
+/**
+ * @brief Run the benchmark with one connection type
+ * @tparam Connection J1939Connection or J1939UringConnection
+ */
+template<typename Connection> bool run(const arguments &args, results &result)
+{
+  boost::asio::io_context context{};
+  jay::network tx_network{ args.tx };
+  jay::network rx_network{ args.rx };
+
+  auto tx_connection = std::make_shared<Connection>(context, tx_network);
+  auto rx_connection = std::make_shared<Connection>(context, rx_network);
+
+  bool measuring{ false };
+  bool failed{ false };
+  std::chrono::nanoseconds start{};
+  std::chrono::nanoseconds cpu_start{};
+
+  auto on_error = [&](auto what, auto error) {
+    std::cerr << what << ": " << error.message() << std::endl;
+    failed = true;
+    context.stop();
+  };
+
+  // Payload carries the time the frame was handed to the connection
+  auto send = [&] {
+    jay::frame frame{ jay::frame_header{ static_cast<priority_t>(6), static_cast<pgn_t>(0xFF00), 0x80, 8 }, {} };
+    auto time = static_cast<std::uint64_t>(now().count());
+    std::memcpy(frame.payload.data(), &time, sizeof(time));
+    tx_connection->SendRaw(frame);
+    if (measuring) { result.frames_sent++; }
+  };
+
+  typename Connection::Callbacks tx_callbacks{};
+  tx_callbacks.on_read = [](auto) {};
+  tx_callbacks.on_error = on_error;
+  tx_connection->SetCallbacks(std::move(tx_callbacks));
+
+  typename Connection::Callbacks rx_callbacks{};
+  rx_callbacks.on_read = [&](jay::frame frame) {
+    std::uint64_t time{};
+    std::memcpy(&time, frame.payload.data(), sizeof(time));
+    if (measuring) {
+      result.frames_received++;
+      result.latency.record(now() - std::chrono::nanoseconds{ static_cast<std::int64_t>(time) });
+    }
+    send();
+  };
+  rx_callbacks.on_error = on_error;
+  rx_connection->SetCallbacks(std::move(rx_callbacks));
+
+  if (!tx_connection->Open({}) || !rx_connection->Open({})) { return false; }
+
+  bridge user_bridge{};
+  if (!args.gateway && !user_bridge.start(args.tx, args.rx)) {
+    std::cerr << "Failed to open bridge between " << args.tx << " and " << args.rx << std::endl;
+    return false;
+  }
+
+  tx_connection->Start();
+  rx_connection->Start();
+  for (std::uint64_t i = 0; i < args.window; i++) { send(); }
+
+  boost::asio::steady_timer timer{ context, args.warmup };
+  timer.async_wait([&](auto error) {
+    if (error) { return; }
+    measuring = true;
+    start = now();
+    cpu_start = cpu_time(RUSAGE_SELF);
+
+    timer.expires_after(args.duration);
+    timer.async_wait([&](auto error) {
+      if (error) { return; }
+      measuring = false;
+      result.elapsed = now() - start;
+      result.cpu = cpu_time(RUSAGE_SELF) - cpu_start;
+      context.stop();
+    });
+  });
+
+  context.run();
+
+  // Bridge cpu is not part of the connections cost, its only measured for the whole run
+  // so scale it to the measured part
+  auto bridge_cpu = user_bridge.stop();
+  auto total = args.warmup + args.duration;
+  result.cpu -= bridge_cpu * args.duration.count() / total.count();
+  result.kernel_drops = kernel_drops(*rx_connection);
+  return !failed;
+}
+
+void write_json(std::ostream &os, const arguments &args, const results &result)
+{
+  auto frames = std::max<std::uint64_t>(result.frames_received, 1);
+  auto seconds = std::chrono::duration<double>(result.elapsed).count();
+
+  os << "{\n"
+     << "  \"benchmark\": \"bridge\",\n"
+     << "  \"mode\": \"" << args.mode << "\",\n"
+     << "  \"tx\": \"" << args.tx << "\",\n"
+     << "  \"rx\": \"" << args.rx << "\",\n"
+     << "  \"bridge\": \"" << (args.gateway ? "gateway" : "user") << "\",\n"
+     << "  \"window\": " << args.window << ",\n"
+     << "  \"duration_s\": " << seconds << ",\n"
+     << "  \"frames_sent\": " << result.frames_sent << ",\n"
+     << "  \"frames_received\": " << result.frames_received << ",\n"
+     << "  \"kernel_drops\": " << result.kernel_drops << ",\n"
+     << "  \"frames_per_second\": " << (seconds > 0 ? static_cast<double>(result.frames_received) / seconds : 0.0)
+     << ",\n"
+     << "  \"cpu_ns_per_frame\": " << result.cpu.count() / static_cast<std::int64_t>(frames) << ",\n"
+     << "  \"latency_ns\": {\n"
+     << "    \"p50\": " << result.latency.percentile(50.0) << ",\n"
+     << "    \"p99\": " << result.latency.percentile(99.0) << ",\n"
+     << "    \"p99.9\": " << result.latency.percentile(99.9) << ",\n"
+     << "    \"max\": " << result.latency.max() << "\n"
+     << "  }\n"
+     << "}\n";
+}
+
+bool parse(int argc, char **argv, arguments &args)
+{
+  for (int i = 1; i < argc; i++) {
+    std::string arg{ argv[i] };
+    auto value = [&]() -> std::string { return i + 1 < argc ? argv[++i] : ""; };
+
+    if (arg == "--mode") {
+      args.mode = value();
+    } else if (arg == "--tx") {
+      args.tx = value();
+    } else if (arg == "--rx") {
+      args.rx = value();
+    } else if (arg == "--duration") {
+      args.duration = std::chrono::seconds{ std::stoul(value()) };
+    } else if (arg == "--warmup") {
+      args.warmup = std::chrono::seconds{ std::stoul(value()) };
+    } else if (arg == "--window") {
+      args.window = std::stoul(value());
+    } else if (arg == "--gateway") {
+      args.gateway = true;
+    } else if (arg == "--out") {
+      args.out = value();
+    } else {
+      std::cerr << "Unknown argument: " << arg << std::endl;
+      return false;
+    }
+  }
+  return args.window > 0 && args.duration.count() > 0;
+}
+
+}// namespace
+
+int main(int argc, char **argv)
+{
+  arguments args{};
+  try {
+    if (!parse(argc, argv, args)) { return 2; }
+  } catch (const std::exception &e) {
+    std::cerr << "Invalid argument: " << e.what() << std::endl;
+    return 2;
+  }
+
+  results result{};
+  bool ok{ false };
+  if (args.mode == "asio") {
+    ok = run<J1939Connection>(args, result);
+#ifdef JAY_HAS_IO_URING
+  } else if (args.mode == "uring") {
+    ok = run<J1939UringConnection>(args, result);
+#endif
+  } else {
+    std::cerr << "Unsupported mode: " << args.mode << std::endl;
+    return 2;
+  }
+  if (!ok) { return 1; }
+
+  if (args.out.empty()) {
+    write_json(std::cout, args, result);
+  } else {
+    std::ofstream file{ args.out };
+    write_json(file, args, result);
+  }
+  return 0;
+}
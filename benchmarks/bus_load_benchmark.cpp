@@ -0,0 +1,50 @@
+//
+// Copyright (c) 2022 Bjørn Fuglestad, Jaersense AS (bjorn@jaersense.no)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/bjorn-jaes/jay
+//
+
+#include "benchmark/benchmark.h"
+
+#include "../include/jay/bus_load.hpp"
+
+// C++
+#include <array>
+#include <cstdint>
+
+namespace {
+
+// Mix of claim, request, peer-to-peer and broadcast ids
+constexpr std::array<std::uint32_t, 8> ids{
+  0x18EEFF01, 0x18EA0203, 0x0CF00400, 0x18FEF100, 0x1CEBFF22, 0x0C000A0B, 0x18FECA33, 0x14F00344
+};
+
+}// namespace
+
+static void BM_Bus_Load_Frame_Bits(benchmark::State &state)
+{
+  std::uint8_t i{ 0 };
+  for (auto _ : state) {
+    jay::frame frame{ jay::frame_header{ ids[i & 7], 8 }, { i, 0, 0, 0xFF, 0xFF, 0, i, 0 } };
+    benchmark::DoNotOptimize(jay::frame_bits(frame));
+    i++;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Bus_Load_Frame_Bits);
+
+static void BM_Bus_Load_Record(benchmark::State &state)
+{
+  jay::bus_load_monitor monitor{};
+  std::uint8_t i{ 0 };
+  for (auto _ : state) {
+    jay::frame frame{ jay::frame_header{ ids[i & 7], 8 }, { i, 0, 0, 0xFF, 0xFF, 0, i, 0 } };
+    monitor.record(frame);
+    i++;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Bus_Load_Record);
@@ -0,0 +1,183 @@
+//
+// Copyright (c) 2022 Bjørn Fuglestad, Jaersense AS (bjorn@jaersense.no)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/bjorn-jaes/jay
+//
+
+#include "benchmark/benchmark.h"
+
+#include "../include/jay/network_manager.hpp"
+
+// C++
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// Libraries
+#include "boost/asio/executor_work_guard.hpp"
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+// Longer than the claim timeout plus the largest cannot claim delay
+constexpr std::chrono::milliseconds quiet_period{ 500 };
+
+// Give up if the storm has not settled by then
+constexpr std::chrono::seconds storm_timeout{ 30 };
+
+// Preferred addresses are spread over this many addresses, so most controllers collide
+constexpr std::int64_t preferred_spread{ 4 };
+
+/**
+ * @brief N local controllers booting at once on a simulated bus
+ *
+ * Every frame a controller sends is posted to the bus context, which loops it back
+ * through network_manager::process like a frame read from the socket. Controllers are
+ * distributed round-robin over one io_context per thread, the bus runs on the first one.
+ */
+class claim_storm
+{
+public:
+  /**
+   * @param managers number of controllers
+   * @param threads number of io_contexts, each run by its own thread
+   */
+  claim_storm(std::int64_t managers, std::int64_t threads)
+    : contexts_(static_cast<std::size_t>(threads)), settled_(static_cast<std::size_t>(managers))
+  {
+    for (std::int64_t i = 0; i < managers; i++) {
+      auto &manager = managers_.emplace_back(contexts_[static_cast<std::size_t>(i % threads)], make_name(i), network_);
+      manager.set_callbacks(jay::address_manager::callbacks{
+        [this, i](jay::name, std::uint8_t) { settle(i, true); },
+        [this, i](jay::name) { settle(i, false); },
+        [this, i](jay::frame frame) {
+          if (frame.header.source_adderess() == J1939_IDLE_ADDR) { settle(i, true); }
+          send(frame);
+        },
+        {} });
+      network_manager_.insert(manager);
+    }
+  }
+
+  /**
+   * @brief Start all controllers and wait until no controller has changed state for the quiet period
+   * @return time from start until the last controller settled
+   */
+  clock_type::duration run()
+  {
+    std::vector<boost::asio::executor_work_guard<boost::asio::io_context::executor_type>> guards{};
+    std::vector<std::thread> threads{};
+    for (auto &context : contexts_) {
+      guards.push_back(boost::asio::make_work_guard(context));
+      threads.emplace_back([&context] { context.run(); });
+    }
+
+    start_ = clock_type::now();
+    last_event_ = start_.time_since_epoch().count();
+    for (std::size_t i = 0; i < managers_.size(); i++) {
+      managers_[i].start_address_claim(static_cast<std::uint8_t>(0x80 + i % preferred_spread));
+    }
+
+    while (clock_type::now() - start_ < storm_timeout) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      auto last = clock_type::time_point{ clock_type::duration{ last_event_.load() } };
+      if (settled_count_.load() == managers_.size() && depth_.load() == 0 && clock_type::now() - last > quiet_period) {
+        break;
+      }
+    }
+
+    for (auto &context : contexts_) { context.stop(); }
+    for (auto &thread : threads) { thread.join(); }
+    return clock_type::time_point{ clock_type::duration{ last_event_.load() } } - start_;
+  }
+
+  std::uint64_t frames() const { return frames_.load(); }
+  std::uint64_t peak_depth() const { return peak_depth_.load(); }
+  std::size_t settled() const { return settled_count_.load(); }
+  std::size_t addresses() const { return network_.address_count(); }
+
+private:
+  /**
+   * @brief Names only differ in the identity number, so all other NAME fields tie
+   * and arbitration falls through to the lowest bits
+   */
+  static jay::name make_name(std::int64_t i)
+  {
+    return jay::name{ static_cast<std::uint32_t>(i), 0x7FF, 0, 0, 0x81, 0x7, 0, 0x1, true };
+  }
+
+  void send(const jay::frame &frame)
+  {
+    frames_++;
+    auto depth = ++depth_;
+    auto peak = peak_depth_.load();
+    while (depth > peak && !peak_depth_.compare_exchange_weak(peak, depth)) {}
+
+    boost::asio::post(contexts_.front(), [this, frame] {
+      network_manager_.process(frame);
+      depth_--;
+    });
+  }
+
+  void settle(std::int64_t i, bool settled)
+  {
+    last_event_ = clock_type::now().time_since_epoch().count();
+    auto previous = settled_[static_cast<std::size_t>(i)].exchange(settled);
+    if (settled && !previous) { settled_count_++; }
+    if (!settled && previous) { settled_count_--; }
+  }
+
+private:
+  std::deque<boost::asio::io_context> contexts_;
+  jay::network network_{ "vcan0" };
+  jay::network_manager network_manager_{ network_ };
+  std::deque<jay::address_manager> managers_{};
+
+  std::vector<std::atomic<bool>> settled_;
+  std::atomic<std::size_t> settled_count_{ 0 };
+  std::atomic<clock_type::rep> last_event_{ 0 };
+  clock_type::time_point start_{};
+
+  std::atomic<std::uint64_t> frames_{ 0 };
+  std::atomic<std::uint64_t> depth_{ 0 };
+  std::atomic<std::uint64_t> peak_depth_{ 0 };
+};
+
+}// namespace
+
+/**
+ * Time to convergence of an address claim storm, reported as manual time
+ */
+static void BM_Claim_Storm(benchmark::State &state)
+{
+  double frames{ 0 };
+  double peak_depth{ 0 };
+  double unsettled{ 0 };
+  double addresses{ 0 };
+  for (auto _ : state) {
+    claim_storm storm{ state.range(0), state.range(1) };
+    state.SetIterationTime(std::chrono::duration<double>(storm.run()).count());
+
+    frames += static_cast<double>(storm.frames());
+    peak_depth = std::max(peak_depth, static_cast<double>(storm.peak_depth()));
+    unsettled += static_cast<double>(static_cast<std::size_t>(state.range(0)) - storm.settled());
+    addresses += static_cast<double>(storm.addresses());
+  }
+  state.counters["frames"] = benchmark::Counter(frames, benchmark::Counter::kAvgIterations);
+  state.counters["peak_queue_depth"] = peak_depth;
+  state.counters["unsettled"] = benchmark::Counter(unsettled, benchmark::Counter::kAvgIterations);
+  state.counters["addresses"] = benchmark::Counter(addresses, benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_Claim_Storm)
+  ->ArgNames({ "managers", "threads" })
+  ->ArgsProduct({ { 1, 8, 32, 128, 253 }, { 1, 4 } })
+  ->Iterations(3)
+  ->UseManualTime()
+  ->Unit(benchmark::kMillisecond);
@@ -0,0 +1,150 @@
+//
+// Copyright (c) 2022 Bjørn Fuglestad, Jaersense AS (bjorn@jaersense.no)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/bjorn-jaes/jay
+//
+
+#include "benchmark/benchmark.h"
+
+#include "../include/jay/frame_columns.hpp"
+#include "../include/jay/spn_columns.hpp"
+
+// C++
+#include <random>
+#include <vector>
+
+namespace {
+
+std::vector<jay::frame> make_frames(std::int64_t count)
+{
+  std::mt19937 generator{ 1939 };
+  std::vector<jay::frame> frames(static_cast<std::size_t>(count));
+  for (auto &frame : frames) {
+    frame.header = jay::frame_header{ static_cast<std::uint32_t>(generator()), 8 };
+    for (auto &byte : frame.payload) { byte = static_cast<std::uint8_t>(generator()); }
+  }
+  return frames;
+}
+
+/**
+ * @brief Mixed traffic where most frames are EEC1, random payloads include sentinel values
+ */
+jay::frame_columns make_eec1_columns(std::int64_t count)
+{
+  auto frames = make_frames(count);
+  for (std::size_t i = 0; i < frames.size(); i++) {
+    if (i % 4 != 0) { frames[i].header = jay::frame_header{ 3, 0xF004, 0x00, 8 }; }
+  }
+  jay::frame_columns columns{};
+  jay::decode_columns(frames.data(), frames.size(), columns);
+  return columns;
+}
+
+void set_counters(benchmark::State &state)
+{
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  state.SetBytesProcessed(state.iterations() * state.range(0) * static_cast<std::int64_t>(sizeof(jay::frame)));
+}
+
+}// namespace
+
+/**
+ * Columns filled with the frame_header getters, one frame at a time
+ */
+static void BM_Frame_Columns_Getters(benchmark::State &state)
+{
+  auto frames = make_frames(state.range(0));
+  jay::frame_columns columns{};
+  for (auto _ : state) {
+    columns.resize(frames.size());
+    for (std::size_t i = 0; i < frames.size(); i++) {
+      auto &header = frames[i].header;
+      columns.id[i] = header.id();
+      columns.pgn[i] = header.pgn();
+      columns.pdu_format[i] = header.pdu_format();
+      columns.pdu_specific[i] = header.pdu_specific();
+      columns.source_address[i] = header.source_adderess();
+      columns.priority[i] = header.priority();
+      columns.length[i] = header.payload_length();
+      columns.payload[i] = jay::to_word(frames[i].payload);
+    }
+    benchmark::ClobberMemory();
+  }
+  set_counters(state);
+}
+BENCHMARK(BM_Frame_Columns_Getters)->Range(1 << 10, 1 << 20);
+
+static void BM_Frame_Columns_Scalar(benchmark::State &state)
+{
+  auto frames = make_frames(state.range(0));
+  jay::frame_columns columns{};
+  for (auto _ : state) {
+    jay::decode_columns_scalar(frames.data(), frames.size(), columns);
+    benchmark::ClobberMemory();
+  }
+  set_counters(state);
+}
+BENCHMARK(BM_Frame_Columns_Scalar)->Range(1 << 10, 1 << 20);
+
+/**
+ * AVX2, NEON or scalar depending on the target, see the label
+ */
+static void BM_Frame_Columns_Simd(benchmark::State &state)
+{
+  auto frames = make_frames(state.range(0));
+  jay::frame_columns columns{};
+  for (auto _ : state) {
+    jay::decode_columns(frames.data(), frames.size(), columns);
+    benchmark::ClobberMemory();
+  }
+  set_counters(state);
+  state.SetLabel(jay::frame_columns::simd);
+}
+BENCHMARK(BM_Frame_Columns_Simd)->Range(1 << 10, 1 << 20);
+
+/**
+ * Engine speed of EEC1 rows converted one value at a time, like a per-frame callback does
+ */
+static void BM_Spn_Columns_Scalar(benchmark::State &state)
+{
+  auto columns = make_eec1_columns(state.range(0));
+  std::vector<double> values(columns.size());
+  const jay::spn_scaling speed{ 24, 16, 0.125, 0.0 };
+  for (auto _ : state) {
+    jay::scale_column_scalar(columns, 0xF004, speed, values.data());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Spn_Columns_Scalar)->Range(1 << 10, 1 << 20);
+
+static void BM_Spn_Columns_Simd(benchmark::State &state)
+{
+  auto columns = make_eec1_columns(state.range(0));
+  std::vector<double> values(columns.size());
+  const jay::spn_scaling speed{ 24, 16, 0.125, 0.0 };
+  for (auto _ : state) {
+    jay::scale_column(columns, 0xF004, speed, values.data());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  state.SetLabel(jay::frame_columns::simd);
+}
+BENCHMARK(BM_Spn_Columns_Simd)->Range(1 << 10, 1 << 20);
+
+static void BM_Spn_Columns_Simd_Float(benchmark::State &state)
+{
+  auto columns = make_eec1_columns(state.range(0));
+  std::vector<float> values(columns.size());
+  const jay::spn_scaling speed{ 24, 16, 0.125, 0.0 };
+  for (auto _ : state) {
+    jay::scale_column(columns, 0xF004, speed, values.data());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  state.SetLabel(jay::frame_columns::simd);
+}
+BENCHMARK(BM_Spn_Columns_Simd_Float)->Range(1 << 10, 1 << 20);
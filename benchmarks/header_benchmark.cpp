@@ -0,0 +1,95 @@
+//
+// Copyright (c) 2022 Bjørn Fuglestad, Jaersense AS (bjorn@jaersense.no)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/bjorn-jaes/jay
+//
+
+#include "benchmark/benchmark.h"
+
+#include "../include/jay/header.hpp"
+
+// C++
+#include <array>
+#include <cstdint>
+
+namespace {
+
+// Mix of claim, request, peer-to-peer and broadcast ids
+constexpr std::array<std::uint32_t, 8> ids{
+  0x18EEFF01, 0x18EA0203, 0x0CF00400, 0x18FEF100, 0x1CEBFF22, 0x0C000A0B, 0x18FECA33, 0x14F00344
+};
+
+}// namespace
+
+static void BM_Header_Encode_Fields(benchmark::State &state)
+{
+  std::uint8_t i{ 0 };
+  for (auto _ : state) {
+    jay::frame_header header{ static_cast<priority_t>(i & 7), (i & 1) == 1, i, static_cast<std::uint8_t>(i + 1), i, 8 };
+    benchmark::DoNotOptimize(header);
+    i++;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Header_Encode_Fields);
+
+static void BM_Header_Encode_Pgn(benchmark::State &state)
+{
+  std::uint8_t i{ 0 };
+  for (auto _ : state) {
+    jay::frame_header header{ static_cast<priority_t>(6), static_cast<pgn_t>(0xF000 | i), i, 8 };
+    benchmark::DoNotOptimize(header);
+    i++;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Header_Encode_Pgn);
+
+static void BM_Header_Set_Fields(benchmark::State &state)
+{
+  jay::frame_header header{};
+  std::uint8_t i{ 0 };
+  for (auto _ : state) {
+    header.priority(static_cast<priority_t>(i & 7)).pdu_format(i).pdu_specific(i).source_adderess(i);
+    benchmark::DoNotOptimize(header);
+    i++;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Header_Set_Fields);
+
+static void BM_Header_Decode(benchmark::State &state)
+{
+  std::array<jay::frame_header, ids.size()> headers{};
+  for (std::size_t i = 0; i < ids.size(); i++) { headers[i] = jay::frame_header{ ids[i], 8 }; }
+
+  std::size_t i{ 0 };
+  for (auto _ : state) {
+    auto &header = headers[i++ % headers.size()];
+    benchmark::DoNotOptimize(header.priority());
+    benchmark::DoNotOptimize(header.pgn());
+    benchmark::DoNotOptimize(header.pdu_specific());
+    benchmark::DoNotOptimize(header.source_adderess());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Header_Decode);
+
+static void BM_Header_Classify(benchmark::State &state)
+{
+  std::array<jay::frame_header, ids.size()> headers{};
+  for (std::size_t i = 0; i < ids.size(); i++) { headers[i] = jay::frame_header{ ids[i], 8 }; }
+
+  std::size_t i{ 0 };
+  for (auto _ : state) {
+    auto &header = headers[i++ % headers.size()];
+    benchmark::DoNotOptimize(header.is_claim());
+    benchmark::DoNotOptimize(header.is_request());
+    benchmark::DoNotOptimize(header.is_broadcast());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Header_Classify);
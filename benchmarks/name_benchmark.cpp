@@ -0,0 +1,67 @@
+//
+// Copyright (c) 2022 Bjørn Fuglestad, Jaersense AS (bjorn@jaersense.no)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/bjorn-jaes/jay
+//
+
+#include "benchmark/benchmark.h"
+
+#include "../include/jay/name.hpp"
+
+// C++
+#include <array>
+#include <cstdint>
+
+static void BM_Name_From_Fields(benchmark::State &state)
+{
+  std::uint32_t i{ 0 };
+  for (auto _ : state) {
+    jay::name name{ i, 0x7FF, 0x1, 0x2, 0x81, 0x7, 0x3, 0x1, true };
+    benchmark::DoNotOptimize(name);
+    i++;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Name_From_Fields);
+
+static void BM_Name_From_Payload(benchmark::State &state)
+{
+  std::array<std::uint8_t, 8> payload{ 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08 };
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(payload);
+    jay::name name{ payload };
+    benchmark::DoNotOptimize(name);
+    payload[0]++;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Name_From_Payload);
+
+static void BM_Name_To_Payload(benchmark::State &state)
+{
+  jay::name name{ 0x0807060504030201 };
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(name);
+    auto payload = static_cast<std::array<std::uint8_t, 8>>(name);
+    benchmark::DoNotOptimize(payload);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Name_To_Payload);
+
+static void BM_Name_Get_Fields(benchmark::State &state)
+{
+  jay::name name{ 0x0807060504030201 };
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(name);
+    benchmark::DoNotOptimize(name.identity_number());
+    benchmark::DoNotOptimize(name.manufacturer_code());
+    benchmark::DoNotOptimize(name.function());
+    benchmark::DoNotOptimize(name.industry_group());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Name_Get_Fields);
@@ -0,0 +1,157 @@
+//
+// Copyright (c) 2022 Bjørn Fuglestad, Jaersense AS (bjorn@jaersense.no)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/bjorn-jaes/jay
+//
+
+#include "benchmark/benchmark.h"
+
+#include "../include/jay/network.hpp"
+
+// C++
+#include <array>
+#include <cstdint>
+
+namespace {
+
+/**
+ * @brief Fill addresses 0 ... occupancy - 1 with names
+ * @param network to fill
+ * @param occupancy number of addresses to take
+ */
+void fill(jay::network &network, std::int64_t occupancy)
+{
+  for (std::int64_t i = 0; i < occupancy; i++) {
+    network.insert(jay::name{ 0x1000 + static_cast<name_t>(i) }, static_cast<std::uint8_t>(i));
+  }
+}
+
+/**
+ * @brief Occupancy levels, from empty to every unicast address taken
+ */
+void occupancy(benchmark::internal::Benchmark *benchmark)
+{
+  for (auto count : { 0, 64, 128, 192, 253 }) { benchmark->Arg(count); }
+}
+
+}// namespace
+
+static void BM_Network_Get_Address(benchmark::State &state)
+{
+  jay::network network{ "vcan0" };
+  fill(network, state.range(0));
+  auto count = std::max<std::int64_t>(state.range(0), 1);
+
+  std::int64_t i{ 0 };
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(network.get_address(jay::name{ 0x1000 + static_cast<name_t>(i++ % count) }));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Network_Get_Address)->Apply(occupancy);
+
+static void BM_Network_Get_Name(benchmark::State &state)
+{
+  jay::network network{ "vcan0" };
+  fill(network, state.range(0));
+  auto count = std::max<std::int64_t>(state.range(0), 1);
+
+  std::int64_t i{ 0 };
+  for (auto _ : state) { benchmark::DoNotOptimize(network.get_name(static_cast<std::uint8_t>(i++ % count))); }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Network_Get_Name)->Apply(occupancy);
+
+static void BM_Network_Insert_Existing(benchmark::State &state)
+{
+  jay::network network{ "vcan0" };
+  fill(network, state.range(0));
+  auto count = std::max<std::int64_t>(state.range(0), 1);
+
+  // Re-inserting a known name and address is the common case when claims are repeated
+  std::int64_t i{ 0 };
+  for (auto _ : state) {
+    auto index = i++ % count;
+    benchmark::DoNotOptimize(
+      network.insert(jay::name{ 0x1000 + static_cast<name_t>(index) }, static_cast<std::uint8_t>(index)));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Network_Insert_Existing)->Apply(occupancy);
+
+static void BM_Network_Insert_Remove(benchmark::State &state)
+{
+  jay::network network{ "vcan0" };
+  fill(network, state.range(0));
+
+  // Use the last unicast address, which is only taken at full occupancy
+  jay::name name{ 0xFFFF };
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(network.insert(name, J1939_MAX_UNICAST_ADDR));
+    network.remove(name);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Network_Insert_Remove)->Apply(occupancy);
+
+static void BM_Network_Find_Address(benchmark::State &state)
+{
+  jay::network network{ "vcan0" };
+  fill(network, state.range(0));
+
+  // Searching from 0 has to skip every taken address
+  jay::name name{ 0xFFFF };
+  for (auto _ : state) { benchmark::DoNotOptimize(network.find_address(name)); }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Network_Find_Address)->Apply(occupancy);
+
+static void BM_Network_Find_Address_Force(benchmark::State &state)
+{
+  jay::network network{ "vcan0" };
+  fill(network, state.range(0));
+
+  // Largest name never wins an address so the whole address space is searched
+  jay::name name{ 0xFFFF'FFFF'FFFF'FFFF };
+  for (auto _ : state) { benchmark::DoNotOptimize(network.find_address(name, 0, true)); }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Network_Find_Address_Force)->Apply(occupancy);
+
+static void BM_Network_Find_Names(benchmark::State &state)
+{
+  jay::network network{ "vcan0" };
+  for (std::int64_t i = 0; i < state.range(0); i++) {
+    jay::name name{ static_cast<std::uint32_t>(i), 0x100, 0, 0, static_cast<std::uint8_t>(i % 16), 0, 0, 0, 0 };
+    network.insert(name, static_cast<std::uint8_t>(i));
+  }
+
+  // One in 16 controllers has the function
+  for (auto _ : state) { benchmark::DoNotOptimize(network.find_names(jay::network::name_field::function, 3)); }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Network_Find_Names)->Apply(occupancy);
+
+static void BM_Network_Get_Name_Set(benchmark::State &state)
+{
+  jay::network network{ "vcan0" };
+  fill(network, state.range(0));
+
+  for (auto _ : state) { benchmark::DoNotOptimize(network.get_name_set()); }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Network_Get_Name_Set)->Apply(occupancy);
+
+static void BM_Network_Export_Entries(benchmark::State &state)
+{
+  jay::network network{ "vcan0" };
+  fill(network, state.range(0));
+
+  std::array<jay::network::entry, J1939_MAX_UNICAST_ADDR + 1> entries{};
+  for (auto _ : state) { benchmark::DoNotOptimize(network.export_entries(entries.data(), entries.size())); }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Network_Export_Entries)->Apply(occupancy);
@@ -0,0 +1,108 @@
+//
+// Copyright (c) 2022 Bjørn Fuglestad, Jaersense AS (bjorn@jaersense.no)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/bjorn-jaes/jay
+//
+
+#include "benchmark/benchmark.h"
+
+#include "../include/jay/network_manager.hpp"
+
+// C++
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+namespace {
+
+/**
+ * @brief Local controllers with claimed addresses and foreign claim frames to feed them
+ */
+struct claim_bench
+{
+  /**
+   * @param managers number of local controllers, they claim addresses 0 ... managers - 1
+   */
+  claim_bench(std::int64_t managers)
+  {
+    for (std::int64_t i = 0; i < managers; i++) {
+      auto &manager = address_managers.emplace_back(context, jay::name{ 0x1000 + static_cast<name_t>(i) }, network);
+      manager.set_callbacks(jay::address_manager::callbacks{ {}, {}, [this](jay::frame) { frames_out++; }, {} });
+      manager.start_address_claim(static_cast<std::uint8_t>(i));
+      network_manager.insert(manager);
+    }
+    // Wait out the 250 ms claim timeout so that all controllers have an address
+    context.run_for(std::chrono::milliseconds(300));
+    context.restart();
+  }
+
+  boost::asio::io_context context{};
+  jay::network network{ "vcan0" };
+  jay::network_manager network_manager{ network };
+  std::deque<jay::address_manager> address_managers{};
+  std::int64_t frames_out{ 0 };
+};
+
+// Claims are posted to the context, drain it after every batch so the queue does not grow
+constexpr std::int64_t batch_size = 64;
+
+}// namespace
+
+static void BM_Network_Manager_Process_Foreign_Claim(benchmark::State &state)
+{
+  claim_bench bench{ state.range(0) };
+
+  // Foreign controllers on the free upper addresses, every local controller gets the claim
+  std::vector<jay::frame> frames{};
+  for (std::uint8_t address = 128; address < J1939_IDLE_ADDR; address++) {
+    frames.push_back(jay::frame::make_address_claim(jay::name{ 0xF000 + static_cast<name_t>(address) }, address));
+  }
+
+  std::size_t i{ 0 };
+  for (auto _ : state) {
+    for (std::int64_t j = 0; j < batch_size; j++) { bench.network_manager.process(frames[i++ % frames.size()]); }
+    bench.context.poll();
+    bench.context.restart();
+  }
+  state.SetItemsProcessed(state.iterations() * batch_size);
+}
+BENCHMARK(BM_Network_Manager_Process_Foreign_Claim)->Arg(1)->Arg(8)->Arg(32);
+
+static void BM_Network_Manager_Process_Contested_Claim(benchmark::State &state)
+{
+  claim_bench bench{ state.range(0) };
+
+  // Foreign controllers with larger names claiming local addresses, local controllers defend them
+  std::vector<jay::frame> frames{};
+  for (std::int64_t i = 0; i < state.range(0); i++) {
+    frames.push_back(
+      jay::frame::make_address_claim(jay::name{ 0xF000 + static_cast<name_t>(i) }, static_cast<std::uint8_t>(i)));
+  }
+
+  std::size_t i{ 0 };
+  for (auto _ : state) {
+    for (std::int64_t j = 0; j < batch_size; j++) { bench.network_manager.process(frames[i++ % frames.size()]); }
+    bench.context.poll();
+    bench.context.restart();
+  }
+  state.SetItemsProcessed(state.iterations() * batch_size);
+  state.counters["frames_out"] = benchmark::Counter(static_cast<double>(bench.frames_out));
+}
+BENCHMARK(BM_Network_Manager_Process_Contested_Claim)->Arg(1)->Arg(8)->Arg(32);
+
+static void BM_Network_Manager_Process_Request(benchmark::State &state)
+{
+  claim_bench bench{ state.range(0) };
+  auto frame = jay::frame::make_address_request();
+
+  for (auto _ : state) {
+    for (std::int64_t j = 0; j < batch_size; j++) { bench.network_manager.process(frame); }
+    bench.context.poll();
+    bench.context.restart();
+  }
+  state.SetItemsProcessed(state.iterations() * batch_size);
+}
+BENCHMARK(BM_Network_Manager_Process_Request)->Arg(1)->Arg(8)->Arg(32);
@@ -0,0 +1,136 @@
+//
+// Copyright (c) 2022 Bjørn Fuglestad, Jaersense AS (bjorn@jaersense.no)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/bjorn-jaes/jay
+//
+
+#include "benchmark/benchmark.h"
+
+#include "../include/jay/pgn_codec.hpp"
+
+// C++
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+namespace {
+
+// Electronic Engine Controller 1 (EEC1), PGN 61444
+using torque_mode = jay::spn<0, 4>;
+using driver_demand_torque = jay::spn<8, 8, std::ratio<1>, std::ratio<-125>>;
+using actual_torque = jay::spn<16, 8, std::ratio<1>, std::ratio<-125>>;
+using engine_speed = jay::spn<24, 16, std::ratio<1, 8>>;
+using source_address = jay::spn<40, 8>;
+
+using eec1 = jay::pgn_codec<0xF004, 3, torque_mode, driver_demand_torque, actual_torque, engine_speed, source_address>;
+
+/**
+ * @brief EEC1 decoded the way applications do it by hand
+ */
+eec1::values decode_by_hand(const jay::payload &payload)
+{
+  return eec1::values{ static_cast<double>(payload[0] & 0x0F),
+    static_cast<double>(payload[1]) - 125.0,
+    static_cast<double>(payload[2]) - 125.0,
+    static_cast<double>(payload[3] | (payload[4] << 8)) * 0.125,
+    static_cast<double>(payload[5]) };
+}
+
+/**
+ * @brief Round a value to the nearest step and saturate it, NaN is encoded as not available (all ones)
+ */
+double saturate_by_hand(double value, double max)
+{
+  return value != value ? max : std::clamp(value + 0.5, 0.0, max);
+}
+
+/**
+ * @brief EEC1 encoded the way applications do it by hand, rounding and saturating values like the codec does
+ */
+jay::payload encode_by_hand(const eec1::values &values)
+{
+  auto speed = static_cast<std::uint16_t>(saturate_by_hand(values[3] * 8.0, 65535.0));
+  return jay::payload{ static_cast<std::uint8_t>(0xF0 | static_cast<std::uint8_t>(saturate_by_hand(values[0], 15.0))),
+    static_cast<std::uint8_t>(saturate_by_hand(values[1] + 125.0, 255.0)),
+    static_cast<std::uint8_t>(saturate_by_hand(values[2] + 125.0, 255.0)),
+    static_cast<std::uint8_t>(speed),
+    static_cast<std::uint8_t>(speed >> 8),
+    static_cast<std::uint8_t>(saturate_by_hand(values[4], 255.0)),
+    0xFF,
+    0xFF };
+}
+
+std::array<jay::payload, 16> make_payloads()
+{
+  std::array<jay::payload, 16> payloads{};
+  for (std::size_t i = 0; i < payloads.size(); i++) {
+    payloads[i] = eec1::encode({ 1.0, 25.0 + i, 30.0 + i, 800.0 + 100.0 * i, 0.0 });
+  }
+  return payloads;
+}
+
+}// namespace
+
+static void BM_Pgn_Codec_Decode_By_Hand(benchmark::State &state)
+{
+  auto payloads = make_payloads();
+  std::size_t i{ 0 };
+  for (auto _ : state) { benchmark::DoNotOptimize(decode_by_hand(payloads[i++ % payloads.size()])); }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Pgn_Codec_Decode_By_Hand);
+
+static void BM_Pgn_Codec_Decode(benchmark::State &state)
+{
+  auto payloads = make_payloads();
+  std::size_t i{ 0 };
+  for (auto _ : state) { benchmark::DoNotOptimize(eec1::decode(payloads[i++ % payloads.size()])); }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Pgn_Codec_Decode);
+
+static void BM_Pgn_Codec_Get_By_Hand(benchmark::State &state)
+{
+  auto payloads = make_payloads();
+  std::size_t i{ 0 };
+  for (auto _ : state) {
+    auto &payload = payloads[i++ % payloads.size()];
+    benchmark::DoNotOptimize(static_cast<double>(payload[3] | (payload[4] << 8)) * 0.125);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Pgn_Codec_Get_By_Hand);
+
+static void BM_Pgn_Codec_Get(benchmark::State &state)
+{
+  auto payloads = make_payloads();
+  std::size_t i{ 0 };
+  for (auto _ : state) { benchmark::DoNotOptimize(eec1::get<engine_speed>(payloads[i++ % payloads.size()])); }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Pgn_Codec_Get);
+
+static void BM_Pgn_Codec_Encode_By_Hand(benchmark::State &state)
+{
+  eec1::values values{ 1.0, 25.0, 30.0, 1200.0, 0.0 };
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(values);
+    benchmark::DoNotOptimize(encode_by_hand(values));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Pgn_Codec_Encode_By_Hand);
+
+static void BM_Pgn_Codec_Encode(benchmark::State &state)
+{
+  eec1::values values{ 1.0, 25.0, 30.0, 1200.0, 0.0 };
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(values);
+    benchmark::DoNotOptimize(eec1::encode(values));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Pgn_Codec_Encode);
@@ -0,0 +1,82 @@
+//
+// Copyright (c) 2022 Bjørn Fuglestad, Jaersense AS (bjorn@jaersense.no)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/bjorn-jaes/jay
+//
+
+#include "benchmark/benchmark.h"
+
+#include "../include/jay/signal_database.hpp"
+
+// C++
+#include <random>
+#include <sstream>
+#include <vector>
+
+namespace {
+
+/**
+ * @brief Generate a database of proprietary B (PDU2) messages, each with 8 byte signals
+ * @param messages number of messages, max 256 * 4
+ */
+jay::signal_database make_database(std::int64_t messages)
+{
+  std::ostringstream dbc{};
+  for (std::int64_t i = 0; i < messages; i++) {
+    // Priority 6, PGN 0x0FF00 - 0x3FFFF spread over data page bits, source address 0xFE
+    auto pgn = 0xFF00 + ((i / 256) << 16) + (i % 256);
+    dbc << "BO_ " << (0x8000'0000U | (6U << 26) | (static_cast<std::uint32_t>(pgn) << 8) | 0xFE) << " Message" << i
+        << ": 8 Node\n";
+    for (int spn = 0; spn < 8; spn++) {
+      dbc << " SG_ Signal" << i << "_" << spn << " : " << spn * 8 << "|8@1+ (0.5,-10) [0|0] \"\" Node\n";
+    }
+  }
+  std::istringstream stream{ dbc.str() };
+  return jay::signal_database::load(stream);
+}
+
+}// namespace
+
+/**
+ * Decode frames with PGNs spread over the whole database
+ */
+static void BM_Signal_Database_Decode(benchmark::State &state)
+{
+  auto database = make_database(state.range(0));
+  std::vector<double> values(database.max_signals());
+
+  std::mt19937 generator{ 1 };
+  std::vector<jay::frame> frames{};
+  for (int i = 0; i < 1024; i++) {
+    auto message = static_cast<pgn_t>(generator() % static_cast<std::uint32_t>(state.range(0)));
+    auto pgn = 0xFF00 + ((message / 256) << 16) + (message % 256);
+    frames.push_back(jay::frame{ jay::frame_header{ 6, pgn, 0xFE, 8 }, { 1, 2, 3, 4, 5, 6, 7, 8 } });
+  }
+
+  std::size_t i{ 0 };
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(database.decode(frames[i++ % frames.size()], values.data()));
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Signal_Database_Decode)->Arg(1)->Arg(64)->Arg(1024);
+
+/**
+ * Frames not in the database, the cost of dispatch alone
+ */
+static void BM_Signal_Database_Miss(benchmark::State &state)
+{
+  auto database = make_database(1024);
+  std::vector<double> values(database.max_signals());
+  jay::frame frame{ jay::frame_header{ 6, 0xEF00, 0xFE, 8 }, {} };
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(frame);
+    benchmark::DoNotOptimize(database.decode(frame, values.data()));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Signal_Database_Miss);
@@ -1,12 +1,58 @@
 #include "j1939_connection.hpp"
 
+// C++
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
 // Linux
 #include <linux/can.h>
+#include <linux/can/raw.h>
+#include <linux/net_tstamp.h>
+#include <sys/socket.h>
 
 // Libraries
 #include "canary/interface_index.hpp"
 #include "canary/socket_options.hpp"
 
+#include "jay/probes.hpp"
+#include "jay/stage_histogram.hpp"
+
+namespace {
+
+// Report the number of frames dropped by the kernel in a control message on every read
+using receive_queue_overflow = boost::asio::detail::socket_option::boolean<SOL_SOCKET, SO_RXQ_OVFL>;
+
+// Recieve frames sent from this socket
+using receive_own_messages = boost::asio::detail::socket_option::boolean<SOL_CAN_RAW, CAN_RAW_RECV_OWN_MSGS>;
+
+// Identifier without priority, the PGN, destination and source address that SendLatest coalesces on
+constexpr std::uint32_t coalesce_key_mask = 0x03FF'FFFF;
+
+// Most sent frames waiting for an echo, older frames are counted as unmatched
+constexpr std::size_t max_in_flight = 1024;
+
+// Kernel software receive time in nanoseconds
+using timestamp_ns = boost::asio::detail::socket_option::boolean<SOL_SOCKET, SO_TIMESTAMPNS>;
+
+// Hardware receive time with software receive time as fallback
+using timestamping = boost::asio::detail::socket_option::integer<SOL_SOCKET, SO_TIMESTAMPING>;
+constexpr int timestamping_flags = SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE
+                                   | SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+
+J1939Connection::Timestamp to_timestamp(const timespec &time)
+{
+  return J1939Connection::Timestamp{ std::chrono::seconds{ time.tv_sec } + std::chrono::nanoseconds{ time.tv_nsec } };
+}
+
+// Most frames read on one wakeup before yielding to other handlers on the context
+constexpr std::size_t max_read_burst = 256;
+
+// Approximate kernel memory (skb truesize) charged to the receive buffer per CAN frame
+constexpr int receive_buffer_frame_size = 768;
+
+}// namespace
+
 J1939Connection::J1939Connection(boost::asio::io_context &io_context, const jay::network &network)
   : socket_(boost::asio::make_strand(io_context)), network_(network)
 {}
@@ -42,6 +88,65 @@ bool J1939Connection::Open(const std::vector<canary::filter> &filters)
     callbacks_.on_error("open", ec);
     return false;
   }
+
+  boost::system::error_code ec;
+  socket_.set_option(receive_queue_overflow{ true }, ec);
+  if (ec) {
+    callbacks_.on_error("open", ec);
+    return false;
+  }
+
+  if (options_.tx_echo) {
+    socket_.set_option(receive_own_messages{ true }, ec);
+    if (ec) {
+      callbacks_.on_error("open", ec);
+      return false;
+    }
+  }
+
+  if (options_.timestamping == Options::Timestamping::software) { socket_.set_option(timestamp_ns{ true }, ec); }
+  if (options_.timestamping == Options::Timestamping::hardware) {
+    socket_.set_option(timestamping{ timestamping_flags }, ec);
+  }
+  if (ec) {
+    callbacks_.on_error("open", ec);
+    return false;
+  }
+
+  boost::asio::socket_base::receive_buffer_size receive_buffer{};
+  socket_.get_option(receive_buffer, ec);
+  if (!ec) { receive_buffer_ = receive_buffer.value(); }
+
+  // Only ever raise the buffer, the default (net.core.rmem_default) is often larger than the minimum.
+  // The kernel reports double the size that was set
+  if (options_.auto_receive_buffer && receive_buffer_ / 2 < options_.min_receive_buffer) {
+    socket_.set_option(boost::asio::socket_base::receive_buffer_size{ options_.min_receive_buffer }, ec);
+    if (ec) {
+      callbacks_.on_error("open", ec);
+      return false;
+    }
+    requested_receive_buffer_ = options_.min_receive_buffer;
+    socket_.get_option(receive_buffer, ec);
+    if (!ec) { receive_buffer_ = receive_buffer.value(); }
+  }
+
+  if (options_.suppress_unchanged) {
+    change_filter_.emplace(options_.keep_alive);
+    for (auto &[pgn, mask] : options_.ignore_masks) { change_filter_->ignore(pgn, mask); }
+  }
+
+  if (options_.bus_load) { bus_load_ = std::make_unique<jay::bus_load_monitor>(options_.bitrate); }
+
+  auto shaped = std::any_of(options_.priority_rates.begin(), options_.priority_rates.end(), [](auto rate) {
+    return rate > 0;
+  });
+  if (shaped || !options_.pgn_rates.empty()) {
+    shaper_ = std::make_unique<jay::tx_shaper>();
+    for (priority_t priority = 0; priority < 8; priority++) {
+      shaper_->limit_priority(priority, options_.priority_rates[priority], options_.burst_bits);
+    }
+    for (auto &[pgn, rate] : options_.pgn_rates) { shaper_->limit_pgn(pgn, rate, options_.burst_bits); }
+  }
   return true;
 }
 
@@ -53,20 +158,106 @@ void J1939Connection::Start()
   Read();
 }
 
+J1939Connection::Stats J1939Connection::GetStats() const
+{
+  Stats stats{ frames_read_.load(std::memory_order_relaxed),
+    frames_sent_.load(std::memory_order_relaxed),
+    kernel_drops_.load(std::memory_order_relaxed),
+    max_burst_.load(std::memory_order_relaxed),
+    receive_buffer_.load(std::memory_order_relaxed) };
+  stats.frames_coalesced = frames_coalesced_.load(std::memory_order_relaxed);
+  stats.frames_deferred = frames_deferred_.load(std::memory_order_relaxed);
+  if (change_filter_) {
+    auto filter_stats = change_filter_->get_stats();
+    stats.frames_suppressed = filter_stats.suppressed;
+    stats.frames_keep_alive = filter_stats.keep_alive;
+  }
+  return stats;
+}
+
+J1939Connection::EchoStats J1939Connection::GetEchoStats() const
+{
+  std::scoped_lock lock{ echo_mtx_ };
+  return echo_stats_;
+}
+
 void J1939Connection::SendRaw(const jay::frame &j1939_frame)
 {
+  JAY_PROBE(frame_enqueue,
+    j1939_frame.header.pgn(),
+    j1939_frame.header.source_adderess(),
+    j1939_frame.header.priority(),
+    local_name_.value_or(J1939_NO_NAME));
+
+  Pending pending{ j1939_frame };
+  if (options_.tx_echo) { pending.queued = std::chrono::system_clock::now(); }
+
   /// TODO: Post our work to the strand, this ensures
   // that the members of `this` will not be
   // accessed concurrently.
-  boost::asio::post(socket_.get_executor(), [j1939_frame, self = shared_from_this()]() {
-    // Always add to queue
-    self->queue_.push(j1939_frame);
+  boost::asio::post(socket_.get_executor(), [pending, self = shared_from_this()]() { self->Enqueue(pending); });
+}
 
-    // Are we already writing?
-    if (self->queue_.size() > 1) { return; }
+void J1939Connection::SendBatch(const std::vector<jay::frame> &frames)
+{
+  if (frames.empty()) { return; }
+
+  std::vector<Pending> batch{};
+  batch.reserve(frames.size());
+  auto queued = options_.tx_echo ? std::chrono::system_clock::now() : Timestamp{};
+  for (auto &j1939_frame : frames) {
+    JAY_PROBE(frame_enqueue,
+      j1939_frame.header.pgn(),
+      j1939_frame.header.source_adderess(),
+      j1939_frame.header.priority(),
+      local_name_.value_or(J1939_NO_NAME));
+    batch.push_back(Pending{ j1939_frame, queued });
+  }
 
-    // We are not currently writing, so send this immediately
-    self->Write();
+  boost::asio::post(socket_.get_executor(), [batch = std::move(batch), self = shared_from_this()]() {
+    for (auto &pending : batch) { self->Enqueue(pending); }
+  });
+}
+
+void J1939Connection::SendLatest(const jay::frame &j1939_frame)
+{
+  JAY_PROBE(frame_enqueue,
+    j1939_frame.header.pgn(),
+    j1939_frame.header.source_adderess(),
+    j1939_frame.header.priority(),
+    local_name_.value_or(J1939_NO_NAME));
+
+  Pending pending{ j1939_frame };
+  if (options_.tx_echo) { pending.queued = std::chrono::system_clock::now(); }
+
+  boost::asio::post(socket_.get_executor(), [pending, self = shared_from_this()]() {
+    auto key = pending.frame.header.id() & coalesce_key_mask;
+
+    // Replace the queued frame, unless it is in front of the queue and being written.
+    // The queue time is kept so echo latency includes the time the message waited
+    if (auto queued = self->coalesce_index_.find(key);
+        queued != self->coalesce_index_.end() && queued->second != self->queue_head_) {
+      self->queue_[queued->second - self->queue_head_].frame = pending.frame;
+      self->frames_coalesced_.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+
+    // Replace the deferred frame of the same priority, it keeps its place and deferral time
+    auto priority = pending.frame.header.priority();
+    if (auto deferred = self->deferred_index_.find(key);
+        deferred != self->deferred_index_.end() && deferred->second.priority == priority) {
+      self->deferred_[priority][deferred->second.sequence - self->deferred_head_[priority]].frame = pending.frame;
+      self->frames_coalesced_.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+
+    auto sequence = self->queue_head_ + self->queue_.size();
+    if (self->Enqueue(pending)) {
+      self->coalesce_index_[key] = sequence;
+    } else {
+      sequence = self->deferred_head_[priority] + self->deferred_[priority].size() - 1;
+      self->deferred_index_[key] = DeferredIndex{ priority, sequence };
+    }
   });
 }
 
@@ -115,30 +306,166 @@ void J1939Connection::OnError(char const *what, boost::system::error_code ec)
   callbacks_.on_error(what, ec);
 }
 
+void J1939Connection::Read()
+{
+  socket_.async_wait(canary::raw::socket::wait_read, [self{ shared_from_this() }](auto error) {
+    if (error) { return self->OnError("read", error); }
+
+    auto drops = self->kernel_drops_.load(std::memory_order_relaxed);
+    auto burst = self->Receive(error);
+    if (error) { return self->OnError("read", error); }
+    self->ResizeReceiveBuffer(burst, self->kernel_drops_.load(std::memory_order_relaxed) - drops);
+
+    // Queue another read
+    self->Read();
+  });
+}
+
 /**
+ * @note Frames are read with recvmsg so that the control messages can be
+ * inspected, the socket is drained so that a burst only costs one wakeup
  * @todo Are we clearing the buffer
  * correctly it seems the header would remain the same
  */
-void J1939Connection::Read()
+std::size_t J1939Connection::Receive(boost::system::error_code &error)
 {
-  socket_.async_receive(canary::net::buffer(&buffer_, sizeof(buffer_)), [self{ shared_from_this() }](auto error, auto) {
-    if (error) { return self->OnError("read", error); }
+  std::size_t burst{ 0 };
+  while (burst < max_read_burst) {
+    iovec io_vector{ &buffer_, sizeof(buffer_) };
+    msghdr message{};
+    message.msg_iov = &io_vector;
+    message.msg_iovlen = 1;
+    message.msg_control = control_.data();
+    message.msg_controllen = control_.size();
+
+    auto length = ::recvmsg(socket_.native_handle(), &message, MSG_DONTWAIT);
+    if (length < 0) {
+      if (errno == EINTR) { continue; }
+      if (errno != EAGAIN && errno != EWOULDBLOCK) { error = { errno, boost::system::system_category() }; }
+      break;
+    }
+    burst++;
+
+    std::optional<Timestamp> timestamp{};
+    bool hardware_time{ false };
+    for (auto *control = CMSG_FIRSTHDR(&message); control != nullptr; control = CMSG_NXTHDR(&message, control)) {
+      if (control->cmsg_level != SOL_SOCKET) { continue; }
+
+      // The counter is cumulative and wraps, so only the difference is added
+      if (control->cmsg_type == SO_RXQ_OVFL) {
+        std::uint32_t drops{};
+        std::memcpy(&drops, CMSG_DATA(control), sizeof(drops));
+        kernel_drops_.fetch_add(static_cast<std::uint32_t>(drops - last_drops_), std::memory_order_relaxed);
+        last_drops_ = drops;
+      }
+
+      if (control->cmsg_type == SCM_TIMESTAMPNS) {
+        timespec time{};
+        std::memcpy(&time, CMSG_DATA(control), sizeof(time));
+        timestamp = to_timestamp(time);
+      }
+
+      // Contains software, deprecated and raw hardware time in that order, unsupported times are zero
+      if (control->cmsg_type == SCM_TIMESTAMPING) {
+        std::array<timespec, 3> times{};
+        std::memcpy(times.data(), CMSG_DATA(control), sizeof(times));
+        hardware_time = times[2].tv_sec != 0 || times[2].tv_nsec != 0;
+        timestamp = to_timestamp(hardware_time ? times[2] : times[0]);
+      }
+    }
+
+    JAY_PROBE(frame_receive,
+      buffer_.header.pgn(),
+      buffer_.header.source_adderess(),
+      buffer_.header.priority(),
+      local_name_.value_or(J1939_NO_NAME));
+
+    // Echoed frames are counted as they used the bus like any other frame
+    if (bus_load_ && static_cast<std::size_t>(length) == sizeof(buffer_)) { bus_load_->record(buffer_); }
+
+    // Hardware time is from the clock of the controller, it can't be compared to the system clock
+    if constexpr (jay::stage_histograms::enabled) {
+      if (timestamp && !hardware_time) {
+        jay::stage_histograms::record(jay::stage::socket_read, std::chrono::system_clock::now() - *timestamp);
+      }
+    }
+
+    // Frames sent from this socket are flagged with MSG_CONFIRM
+    if (message.msg_flags & MSG_CONFIRM) {
+      OnEcho(timestamp.value_or(std::chrono::system_clock::now()));
+      continue;
+    }
+
+    // Activity is recorded before filtering, so that every controller on the bus is tracked
+    if (static_cast<std::size_t>(length) == sizeof(buffer_)) { network_.seen(buffer_.header.source_adderess()); }
+
+    jay::stage_timer check_timer{};
+    auto accepted = static_cast<std::size_t>(length) == sizeof(buffer_) && CheckAddress();
+    check_timer.record(jay::stage::check_address);
+
+    // Suppressed frames are still counted as read
+    if (accepted && change_filter_) { accepted = change_filter_->pass(buffer_); }
 
     // Trigger callback with frame if we are supposed to get the frame
-    if (self->CheckAddress()) { self->callbacks_.on_read(self->buffer_); }
+    if (accepted) {
+      jay::stage_timer callback_timer{};
+      if (callbacks_.on_timed_read) {
+        callbacks_.on_timed_read(buffer_, timestamp.value_or(std::chrono::system_clock::now()));
+      } else {
+        callbacks_.on_read(buffer_);
+      }
+      callback_timer.record(jay::stage::user_callback);
+    }
 
     // Clear buffer
-    self->buffer_.payload.fill(0);
-    self->buffer_.header.id(0);
+    buffer_.payload.fill(0);
+    buffer_.header.id(0);
+  }
 
-    // Queue another read
-    self->Read();
-  });
+  frames_read_.fetch_add(burst, std::memory_order_relaxed);
+  if (burst > max_burst_.load(std::memory_order_relaxed)) { max_burst_.store(burst, std::memory_order_relaxed); }
+  return burst;
+}
+
+/**
+ * @note The buffer only grows, as a burst that has been seen once will likely be seen again.
+ * Use max_receive_buffer to bound memory use on small devices.
+ */
+void J1939Connection::ResizeReceiveBuffer(std::size_t burst, std::uint64_t drops)
+{
+  if (!options_.auto_receive_buffer) { return; }
+
+  // Keep room for twice the burst, the kernel reports double the size that was set
+  auto current = receive_buffer_.load(std::memory_order_relaxed) / 2;
+  auto required = static_cast<int>(burst) * receive_buffer_frame_size * 2;
+  if (drops > 0) { required = std::max(required, current * 2); }
+
+  required = std::min(required, options_.max_receive_buffer);
+  if (required <= current || required <= requested_receive_buffer_) { return; }
+  requested_receive_buffer_ = required;
+
+  boost::system::error_code ec;
+  socket_.set_option(boost::asio::socket_base::receive_buffer_size{ required }, ec);
+  if (ec) { return OnError("receive_buffer", ec); }
+
+  boost::asio::socket_base::receive_buffer_size receive_buffer{};
+  socket_.get_option(receive_buffer, ec);
+  if (!ec) { receive_buffer_ = receive_buffer.value(); }
 }
 
 void J1939Connection::Write()
 {
-  auto j1939_frame = queue_.front();
+  auto j1939_frame = queue_.front().frame;
+
+  // Track before sending, as the echo can be read before the send completes
+  if (options_.tx_echo) {
+    in_flight_.push_back(queue_.front());
+    if (in_flight_.size() > max_in_flight) {
+      in_flight_.pop_front();
+      std::scoped_lock lock{ echo_mtx_ };
+      echo_stats_.unmatched++;
+    }
+  }
 
   /// TODO: Migh want to use async write as send might not send all the information
   /// though will have to see
@@ -146,19 +473,119 @@ void J1939Connection::Write()
   socket_.async_send(canary::net::buffer(&j1939_frame, sizeof(j1939_frame)),
     [j1939_frame, self{ shared_from_this() }](auto error, auto) {
       // Handle the error, if any
-      if (error) { return self->OnError("write", error); }
+      if (error) {
+        if (self->options_.tx_echo && !self->in_flight_.empty()) { self->in_flight_.pop_back(); }
+        return self->OnError("write", error);
+      }
+
+      self->frames_sent_.fetch_add(1, std::memory_order_relaxed);
+
+      // Own frames are not read back, so the activity of the local controller is recorded here
+      self->network_.seen(j1939_frame.header.source_adderess());
+      JAY_PROBE(frame_sent,
+        j1939_frame.header.pgn(),
+        j1939_frame.header.source_adderess(),
+        j1939_frame.header.priority(),
+        self->local_name_.value_or(J1939_NO_NAME));
 
       // Callback with data sent
       if (self->callbacks_.on_send) { self->callbacks_.on_send(j1939_frame); };
 
       // Remove the string from the queue
-      self->queue_.pop();
+      self->PopQueue();
 
       // Send the next message if any
       if (!self->queue_.empty()) { self->Write(); }
     });
 }
 
+bool J1939Connection::Enqueue(const Pending &pending)
+{
+  if (shaper_) {
+    auto &deferred = deferred_[pending.frame.header.priority()];
+
+    // Frames behind deferred frames of the same priority are deferred to keep their order
+    if (!deferred.empty() || !shaper_->try_send(pending.frame)) {
+      deferred.push_back(pending);
+      deferred.back().deferred = std::chrono::steady_clock::now();
+      frames_deferred_.fetch_add(1, std::memory_order_relaxed);
+      ScheduleDeferred();
+      return false;
+    }
+    shaper_->record_conforming();
+  }
+
+  queue_.push_back(pending);
+
+  // We are not currently writing, so send this immediately
+  if (queue_.size() == 1) { Write(); }
+  return true;
+}
+
+void J1939Connection::ReleaseDeferred()
+{
+  auto now = std::chrono::steady_clock::now();
+  for (priority_t priority = 0; priority < 8; priority++) {
+    auto &deferred = deferred_[priority];
+    while (!deferred.empty() && shaper_->try_send(deferred.front().frame, now)) {
+      shaper_->record_deferral(priority, now - deferred.front().deferred);
+
+      // A released SendLatest frame is replaced in the queue from now on
+      if (!deferred_index_.empty()) {
+        auto key = deferred.front().frame.header.id() & coalesce_key_mask;
+        auto it = deferred_index_.find(key);
+        if (it != deferred_index_.end() && it->second.priority == priority
+            && it->second.sequence == deferred_head_[priority]) {
+          coalesce_index_[key] = queue_head_ + queue_.size();
+          deferred_index_.erase(it);
+        }
+      }
+
+      queue_.push_back(deferred.front());
+      deferred.pop_front();
+      deferred_head_[priority]++;
+      frames_deferred_.fetch_sub(1, std::memory_order_relaxed);
+      if (queue_.size() == 1) { Write(); }
+    }
+  }
+  ScheduleDeferred();
+}
+
+/**
+ * @note One timer is shared by all priorities, it is set to the first frame that can be released
+ */
+void J1939Connection::ScheduleDeferred()
+{
+  if (deferred_armed_) { return; }
+
+  auto now = std::chrono::steady_clock::now();
+  std::optional<std::chrono::steady_clock::duration> wait{};
+  for (auto &deferred : deferred_) {
+    if (deferred.empty()) { continue; }
+    auto frame_wait = shaper_->wait(deferred.front().frame, now);
+    wait = wait ? std::min(*wait, frame_wait) : frame_wait;
+  }
+  if (!wait) { return; }
+
+  deferred_armed_ = true;
+  deferred_timer_.expires_after(*wait);
+  deferred_timer_.async_wait([self{ shared_from_this() }](auto error) {
+    self->deferred_armed_ = false;
+    if (error) { return self->OnError("shaper", error); }
+    self->ReleaseDeferred();
+  });
+}
+
+void J1939Connection::PopQueue()
+{
+  if (!coalesce_index_.empty()) {
+    auto it = coalesce_index_.find(queue_.front().frame.header.id() & coalesce_key_mask);
+    if (it != coalesce_index_.end() && it->second == queue_head_) { coalesce_index_.erase(it); }
+  }
+  queue_.pop_front();
+  queue_head_++;
+}
+
 /**
  * @note Since we are using raw can the filter cant be sure if the recieved message is for us.
  * As dynamic addressing could cause a filter to be invalid if the source address was
@@ -194,4 +621,35 @@ bool J1939Connection::CheckAddress() const
   if (target_name_ && !local_name_) { return network_.get_address(*target_name_) == buffer_.header.source_adderess(); }
 
   return false;
-}
\ No newline at end of file
+}
+/**
+ * @note The kernel echoes frames in the order they were sent, so the echo normaly
+ * matches the oldest frame in flight. Frames in front of the match were never echoed.
+ */
+void J1939Connection::OnEcho(Timestamp time)
+{
+  auto it = std::find_if(in_flight_.begin(), in_flight_.end(), [this](const Pending &pending) {
+    return pending.frame.header.id() == buffer_.header.id()
+           && pending.frame.header.payload_length() == buffer_.header.payload_length()
+           && pending.frame.payload == buffer_.payload;
+  });
+  if (it == in_flight_.end()) { return; }
+
+  auto latency = std::max(std::chrono::nanoseconds{}, time - it->queued);
+  auto record = [latency](EchoLatency &stats) {
+    stats.count++;
+    stats.total += latency;
+    stats.max = std::max(stats.max, latency);
+  };
+
+  {
+    std::scoped_lock lock{ echo_mtx_ };
+    record(echo_stats_.priority[it->frame.header.priority()]);
+    record(echo_stats_.pgn[it->frame.header.pgn()]);
+    echo_stats_.unmatched += static_cast<std::uint64_t>(std::distance(in_flight_.begin(), it));
+  }
+
+  auto frame = it->frame;
+  in_flight_.erase(in_flight_.begin(), std::next(it));
+  if (callbacks_.on_echo) { callbacks_.on_echo(frame, latency); }
+}
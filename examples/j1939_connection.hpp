@@ -13,18 +13,32 @@
 #pragma once
 
 // C++
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <deque>
 #include <functional>
-#include <queue>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
 #include <vector>
 
+// Linux
+#include <sys/socket.h>
+#include <time.h>
+
 // Libraries
 #include "boost/asio.hpp"
 
 #include "canary/filter.hpp"
 #include "canary/raw.hpp"
 
+#include "jay/bus_load.hpp"
+#include "jay/change_filter.hpp"
 #include "jay/frame.hpp"
 #include "jay/network.hpp"
+#include "jay/tx_shaper.hpp"
 
 // Local
 
@@ -41,6 +55,13 @@
 class J1939Connection : public std::enable_shared_from_this<J1939Connection>
 {
 public:
+  /**
+   * @brief Receive time of a frame as reported by the kernel
+   * @note Software timestamps use CLOCK_REALTIME, hardware timestamps use
+   * the clock of the CAN device which might not be synchronized with the host
+   */
+  using Timestamp = std::chrono::time_point<std::chrono::system_clock, std::chrono::nanoseconds>;
+
   /**
    * @brief Struct containing callbacks for J1939Connection
    */
@@ -50,6 +71,8 @@ public:
     using J1939OnSelf = std::function<void(J1939Connection *)>;
     using J1939OnError = std::function<void(const std::string, const boost::system::error_code)>;
     using J1939OnFrame = std::function<void(jay::frame)>;
+    using J1939OnTimedFrame = std::function<void(jay::frame, Timestamp)>;
+    using J1939OnEcho = std::function<void(jay::frame, std::chrono::nanoseconds)>;
 
     /**
      * @brief Callback for when connection is stated
@@ -65,7 +88,7 @@ public:
 
     /**
      * @brief Callback for when data is recieved
-     * @note is required
+     * @note is required, unless on_timed_read is set
      */
     J1939OnFrame on_read;
 
@@ -83,6 +106,166 @@ public:
      * @note is required
      */
     J1939OnError on_error;
+
+    /**
+     * @brief Callback for when data is recieved, with the time the kernel recieved the frame
+     * @note is optional, if set it is called instead of on_read
+     * @see Options::timestamping
+     */
+    J1939OnTimedFrame on_timed_read;
+
+    /**
+     * @brief Callback for when a sent frame is echoed back from the bus,
+     * with the time from the frame was queued until it was on the bus
+     * @note is optional
+     * @see Options::tx_echo
+     */
+    J1939OnEcho on_echo;
+  };
+
+  /**
+   * @brief Socket options for J1939Connection, applied when the connection is opened
+   */
+  struct Options
+  {
+    /**
+     * @brief Source of the receive timestamp passed to on_timed_read
+     */
+    enum class Timestamping
+    {
+      none, /**< Frames are stamped when they are read from the socket */
+      software, /**< Kernel software receive time (SO_TIMESTAMPNS) */
+      hardware /**< CAN device receive time when supported, kernel software time if not (SO_TIMESTAMPING) */
+    };
+
+    /**
+     * @brief Timestamp source for recieved frames
+     */
+    Timestamping timestamping{ Timestamping::none };
+
+    /**
+     * @brief Recieve our own frames when they are on the bus (CAN_RAW_RECV_OWN_MSGS)
+     * and match them to sent frames to measure queue to wire latency
+     * @note Echoed frames are not passed to on_read. Use software timestamping for accurate latency
+     * @see GetEchoStats
+     */
+    bool tx_echo{ false };
+
+    /**
+     * @brief Grow the socket receive buffer (SO_RCVBUF) from the largest
+     * burst of frames observed and when the kernel reports dropped frames
+     */
+    bool auto_receive_buffer{ true };
+
+    /**
+     * @brief Size in bytes the receive buffer is raised to when the connection is opened,
+     * a larger default size is kept
+     * @note is only used if auto_receive_buffer is set
+     */
+    int min_receive_buffer{ 32 * 1024 };
+
+    /**
+     * @brief Size in bytes the receive buffer is never grown past
+     * @note the kernel also limits the size to net.core.rmem_max
+     */
+    int max_receive_buffer{ 1024 * 1024 };
+
+    /**
+     * @brief Only pass a frame on if its payload changed since the last frame passed on
+     * with the same PGN and source address, or if the keep alive period has passed.
+     * Only broadcast frames are suppressed, peer-to-peer frames are always passed on
+     * @see Stats::frames_suppressed
+     */
+    bool suppress_unchanged{ false };
+
+    /**
+     * @brief Period after which an unchanged frame is passed on anyway, zero to never pass them on
+     * @note is only used if suppress_unchanged is set
+     */
+    std::chrono::milliseconds keep_alive{ 1000 };
+
+    /**
+     * @brief Payload bits per PGN that are ignored when comparing, such as counters and checksums
+     * @note is only used if suppress_unchanged is set, @see jay::to_word for the bit order
+     */
+    std::unordered_map<pgn_t, std::uint64_t> ignore_masks{};
+
+    /**
+     * @brief Measure bus load from every frame read, in total, per source address and per PGN
+     * @note Frames sent from this connection are only counted if tx_echo is set
+     * @see GetBusLoad
+     */
+    bool bus_load{ false };
+
+    /**
+     * @brief Bitrate of the bus in bits/s
+     * @note is only used if bus_load is set
+     */
+    std::uint32_t bitrate{ 250000 };
+
+    /**
+     * @brief Bits/s frames of each priority may use, zero for no limit
+     * @note Frames over the limit are deferred in order within their priority,
+     * deferred frames are released highest priority first
+     * @see GetShaper
+     */
+    std::array<std::uint32_t, 8> priority_rates{};
+
+    /**
+     * @brief Bits/s frames of a PGN may use, in addition to the limit of their priority
+     */
+    std::unordered_map<pgn_t, std::uint32_t> pgn_rates{};
+
+    /**
+     * @brief Bits that can be sent back to back before a limit applies
+     * @note is only used if a rate is set
+     */
+    std::uint32_t burst_bits{ 8 * jay::tx_shaper::max_frame_bits };
+  };
+
+  /**
+   * @brief Snapshot of connection statistics
+   */
+  struct Stats
+  {
+    std::uint64_t frames_read{}; /**< Frames read from the socket */
+    std::uint64_t frames_sent{}; /**< Frames accepted by the socket */
+    std::uint64_t kernel_drops{}; /**< Frames dropped by the kernel as the receive buffer was full (SO_RXQ_OVFL) */
+    std::uint64_t max_burst{}; /**< Most frames read from the socket on a single wakeup */
+    int receive_buffer{}; /**< Current receive buffer size as reported by the kernel */
+    std::uint64_t frames_suppressed{}; /**< Unchanged frames not passed on, @see Options::suppress_unchanged */
+    std::uint64_t frames_keep_alive{}; /**< Unchanged frames passed on as the keep alive period passed */
+    std::uint64_t frames_coalesced{}; /**< Queued frames replaced by a newer frame, @see SendLatest */
+    std::uint64_t frames_deferred{}; /**< Frames currently waiting for the shaper, @see Options::priority_rates */
+  };
+
+  /**
+   * @brief Queue to wire latency of echoed frames
+   */
+  struct EchoLatency
+  {
+    std::uint64_t count{}; /**< Frames echoed */
+    std::chrono::nanoseconds total{}; /**< Sum of latency for all frames */
+    std::chrono::nanoseconds max{}; /**< Largest latency */
+
+    /**
+     * @brief Get the mean latency
+     * @return mean latency, or zero if no frames were echoed
+     */
+    std::chrono::nanoseconds mean() const
+    {
+      return count > 0 ? total / static_cast<std::int64_t>(count) : std::chrono::nanoseconds{};
+    }
+  };
+
+  /**
+   * @brief Snapshot of echo latency statistics
+   */
+  struct EchoStats
+  {
+    std::array<EchoLatency, 8> priority{}; /**< Latency per frame priority */
+    std::unordered_map<pgn_t, EchoLatency> pgn{}; /**< Latency per PGN */
+    std::uint64_t unmatched{}; /**< Sent frames that were never echoed */
   };
 
   /**
@@ -144,6 +327,41 @@ public:
    */
   void SetCallbacks(Callbacks &&callbacks) { callbacks_ = std::move(callbacks); }
 
+  /**
+   * @brief Set the socket options
+   * @param options for the socket
+   * @note must be set before calling Open
+   */
+  void SetOptions(Options &&options) { options_ = std::move(options); }
+
+  /**
+   * @brief Get statistics for the connection
+   * @return snapshot of the current statistics
+   * @note is safe to call from any thread
+   */
+  Stats GetStats() const;
+
+  /**
+   * @brief Get queue to wire latency statistics
+   * @return snapshot of the current echo statistics
+   * @note is only updated if Options::tx_echo is set, is safe to call from any thread
+   */
+  EchoStats GetEchoStats() const;
+
+  /**
+   * @brief Get the bus load monitor
+   * @return monitor, or nullptr if Options::bus_load is not set
+   * @note the monitor is safe to read from any thread
+   */
+  const jay::bus_load_monitor *GetBusLoad() const { return bus_load_.get(); }
+
+  /**
+   * @brief Get the transmit shaper
+   * @return shaper, or nullptr if no rates are set in Options
+   * @note only get_stats is safe to call from another thread
+   */
+  const jay::tx_shaper *GetShaper() const { return shaper_.get(); }
+
   /**
    * @brief Set the local j1939 name
    * @param name of the device this connection is sending
@@ -185,6 +403,25 @@ public:
    */
   void SendRaw(const jay::frame &j1939_frame);
 
+  /**
+   * Send frames to socket without any checks, all frames are
+   * queued in one event so that they are written back to back
+   * @param frames that will be sent, in order
+   * @see jay::cyclic_scheduler
+   */
+  void SendBatch(const std::vector<jay::frame> &frames);
+
+  /**
+   * Send a frame to socket without any checks, replacing a queued frame with the same
+   * PGN, source and destination address instead of being appended after it
+   * @param j1939_frame that will be sent
+   * @note Used for periodic frames where only the latest value matters, so that the
+   * queue is bounded by the number of distinct messages when the bus is congested or
+   * the frames are deferred by the shaper
+   * @see Stats::frames_coalesced
+   */
+  void SendLatest(const jay::frame &j1939_frame);
+
   /**
    * Send a broadcast frame to the socket
    * @param j1939_frame that will be broadcast, the source address
@@ -226,23 +463,68 @@ private:
   void OnError(char const *what, boost::system::error_code ec);
 
   /**
-   * Read data from socket
+   * Wait for data on the socket
    */
   void Read();
 
+  /**
+   * Read all frames that are available on the socket
+   * @param error set if reading from the socket failed
+   * @return number of frames read
+   */
+  std::size_t Receive(boost::system::error_code &error);
+
+  /**
+   * Grow the receive buffer if the observed burst or kernel drops indicate that it is too small
+   * @param burst number of frames read on the last wakeup
+   * @param drops new frames dropped by the kernel since the last wakeup
+   */
+  void ResizeReceiveBuffer(std::size_t burst, std::uint64_t drops);
+
   /**
    * Write frames from qeueu to socket
    */
   void Write();
 
+  /**
+   * Remove the frame in front of the queue after it has been written
+   */
+  void PopQueue();
+
+  struct Pending;
+
+  /**
+   * Add a frame to the queue and start writing, or defer it if it exceeds the shaping rates
+   * @param pending frame to send
+   * @return true if queued, false if deferred
+   */
+  bool Enqueue(const Pending &pending);
+
+  /**
+   * Queue deferred frames that conform to the shaping rates, highest priority first
+   */
+  void ReleaseDeferred();
+
+  /**
+   * Wait until the first deferred frame conforms, if not already waiting
+   */
+  void ScheduleDeferred();
+
   bool CheckAddress() const;
 
+  /**
+   * Match an echoed frame to a sent frame and record the latency
+   * @param time the frame was on the bus
+   */
+  void OnEcho(Timestamp time);
+
 private:
   // Injected
 
   canary::raw::socket socket_; /**< raw CAN-bus socket */
   const jay::network &network_; /**< Network reference for querying network for addresses */
   Callbacks callbacks_; /**< Callbacks for generated events */
+  Options options_{}; /**< Socket options */
 
   std::optional<jay::name> local_name_{}; /**< Optional local j1939 name */
   std::optional<jay::name> target_name_{}; /**< Optional targeted j1939 name */
@@ -250,7 +532,51 @@ private:
   // Internal
 
   jay::frame buffer_{}; /**< Incomming frame buffer */
-  std::queue<jay::frame> queue_{}; /**< Outgoing  frame queue */
+  alignas(cmsghdr) std::array<char,
+    CMSG_SPACE(sizeof(std::uint32_t)) + CMSG_SPACE(3 * sizeof(timespec))> control_{}; /**< Control message buffer */
+  /**
+   * @brief Frame waiting to be sent or echoed
+   */
+  struct Pending
+  {
+    jay::frame frame{};
+    Timestamp queued{}; /**< Time the frame was passed to the connection, only set with tx echo */
+    std::chrono::steady_clock::time_point deferred{}; /**< Time the frame was deferred by the shaper */
+  };
+
+  /**
+   * @brief Position of a SendLatest frame deferred by the shaper
+   */
+  struct DeferredIndex
+  {
+    priority_t priority{}; /**< Deferred queue the frame is in */
+    std::uint64_t sequence{}; /**< Sequence number of the frame in the deferred queue */
+  };
+
+  std::deque<Pending> queue_{}; /**< Outgoing  frame queue */
+  std::uint64_t queue_head_{}; /**< Sequence number of the frame in front of the queue */
+  std::unordered_map<std::uint32_t, std::uint64_t> coalesce_index_{}; /**< Queued SendLatest frames */
+  std::deque<Pending> in_flight_{}; /**< Frames accepted by the socket that have not been echoed */
+  EchoStats echo_stats_{}; /**< Queue to wire latency */
+  mutable std::mutex echo_mtx_{}; /**< Guards echo_stats_ */
+
+  std::atomic<std::uint64_t> frames_read_{}; /**< Frames read from the socket */
+  std::atomic<std::uint64_t> frames_sent_{}; /**< Frames accepted by the socket */
+  std::uint32_t last_drops_{}; /**< Last SO_RXQ_OVFL counter, it wraps at 2^32 */
+  std::atomic<std::uint64_t> kernel_drops_{}; /**< Kernel drops since the socket was opened */
+  std::atomic<std::uint64_t> max_burst_{}; /**< Most frames read on a single wakeup */
+  std::atomic<std::uint64_t> frames_coalesced_{}; /**< Queued frames replaced by SendLatest */
+  std::atomic<int> receive_buffer_{}; /**< Current receive buffer size */
+  int requested_receive_buffer_{}; /**< Last receive buffer size requested from the kernel */
+  std::optional<jay::change_filter> change_filter_{}; /**< Set if unchanged frames are suppressed */
+  std::unique_ptr<jay::bus_load_monitor> bus_load_{}; /**< Set if bus load is measured */
+  std::unique_ptr<jay::tx_shaper> shaper_{}; /**< Set if a shaping rate is set */
+  std::array<std::deque<Pending>, 8> deferred_{}; /**< Frames deferred by the shaper per priority */
+  std::array<std::uint64_t, 8> deferred_head_{}; /**< Sequence number of the frame in front of each deferred queue */
+  std::unordered_map<std::uint32_t, DeferredIndex> deferred_index_{}; /**< Deferred SendLatest frames */
+  std::atomic<std::uint64_t> frames_deferred_{}; /**< Frames in deferred_ */
+  boost::asio::steady_timer deferred_timer_{ socket_.get_executor() }; /**< Releases deferred frames */
+  bool deferred_armed_{ false };
 };
 
 #endif
\ No newline at end of file
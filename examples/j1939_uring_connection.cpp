@@ -0,0 +1,359 @@
+#include "j1939_uring_connection.hpp"
+
+// C++
+#include <cstring>
+
+// Linux
+#include <linux/can.h>
+#include <linux/can/raw.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Libraries
+#include "canary/interface_index.hpp"
+
+namespace {
+
+// Buffer group used for the receive buffer ring
+constexpr int rx_group_id = 0;
+
+// Tags stored in the upper bits of the sqe user data, lower bits hold the tx slot
+constexpr std::uint64_t rx_tag = 1ULL << 32;
+constexpr std::uint64_t tx_tag = 2ULL << 32;
+constexpr std::uint64_t slot_mask = 0xFFFF'FFFFULL;
+
+boost::system::error_code make_error(int error) { return { error, boost::system::system_category() }; }
+
+}// namespace
+
+J1939UringConnection::J1939UringConnection(boost::asio::io_context &io_context, const jay::network &network)
+  : strand_(boost::asio::make_strand(io_context)), network_(network), event_fd_(strand_)
+{}
+
+J1939UringConnection::J1939UringConnection(boost::asio::io_context &io_context,
+  const jay::network &network,
+  Callbacks &&callbacks)
+  : strand_(boost::asio::make_strand(io_context)), network_(network), callbacks_(std::move(callbacks)),
+    event_fd_(strand_)
+{}
+
+J1939UringConnection::J1939UringConnection(boost::asio::io_context &io_context,
+  const jay::network &network,
+  Callbacks &&callbacks,
+  std::optional<jay::name> local_name,
+  std::optional<jay::name> target_name)
+  : strand_(boost::asio::make_strand(io_context)), network_(network), callbacks_(std::move(callbacks)),
+    local_name_(local_name), target_name_(target_name), event_fd_(strand_)
+{}
+
+J1939UringConnection::~J1939UringConnection()
+{
+  if (callbacks_.on_destroy) { callbacks_.on_destroy(this); }
+
+  if (ring_open_) {
+    if (rx_ring_) { io_uring_free_buf_ring(&ring_, rx_ring_, rx_frame_count, rx_group_id); }
+    io_uring_queue_exit(&ring_);
+  }
+  if (socket_fd_ >= 0) { ::close(socket_fd_); }
+}
+
+bool J1939UringConnection::Open(const std::vector<canary::filter> &filters)
+{
+  socket_fd_ = ::socket(PF_CAN, SOCK_RAW | SOCK_CLOEXEC, CAN_RAW);
+  if (socket_fd_ < 0) {
+    callbacks_.on_error("open", make_error(errno));
+    return false;
+  }
+
+  sockaddr_can address{};
+  address.can_family = AF_CAN;
+  try {
+    address.can_ifindex = static_cast<int>(canary::get_interface_index(network_.get_interface_name()));
+  } catch (const boost::system::system_error &e) {
+    callbacks_.on_error("open", e.code());
+    return false;
+  }
+  if (::bind(socket_fd_, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0) {
+    callbacks_.on_error("open", make_error(errno));
+    return false;
+  }
+
+  // Report kernel drops in the control data of every frame
+  int enable{ 1 };
+  if (::setsockopt(socket_fd_, SOL_SOCKET, SO_RXQ_OVFL, &enable, sizeof(enable)) < 0) {
+    callbacks_.on_error("open", make_error(errno));
+    return false;
+  }
+
+  if (filters.size() > 0
+      && ::setsockopt(
+           socket_fd_, SOL_CAN_RAW, CAN_RAW_FILTER, filters.data(), filters.size() * sizeof(canary::filter))
+           < 0) {
+    callbacks_.on_error("open", make_error(errno));
+    return false;
+  }
+
+  // Room for the multishot recvmsg and a full batch of writes
+  if (auto ret = io_uring_queue_init(tx_frame_count * 2, &ring_, 0); ret < 0) {
+    callbacks_.on_error("open", make_error(-ret));
+    return false;
+  }
+  ring_open_ = true;
+
+  // Outgoing frames are written from the registered frame array
+  iovec tx_iovec{ tx_frames_.data(), sizeof(tx_frames_) };
+  if (auto ret = io_uring_register_buffers(&ring_, &tx_iovec, 1); ret < 0) {
+    callbacks_.on_error("open", make_error(-ret));
+    return false;
+  }
+
+  // Incomming frames are selected by the kernel from the provided buffer ring
+  int ret{};
+  rx_ring_ = io_uring_setup_buf_ring(&ring_, rx_frame_count, rx_group_id, 0, &ret);
+  if (!rx_ring_) {
+    callbacks_.on_error("open", make_error(-ret));
+    return false;
+  }
+  auto mask = io_uring_buf_ring_mask(rx_frame_count);
+  for (std::size_t i = 0; i < rx_frame_count; i++) {
+    io_uring_buf_ring_add(rx_ring_, rx_buffers_[i].data(), rx_buffer_size, static_cast<unsigned short>(i), mask, i);
+  }
+  rx_message_.msg_controllen = CMSG_SPACE(sizeof(std::uint32_t));
+  io_uring_buf_ring_advance(rx_ring_, rx_frame_count);
+
+  tx_free_.reserve(tx_frame_count);
+  for (std::size_t i = 0; i < tx_frame_count; i++) {
+    tx_free_.push_back(static_cast<std::uint16_t>(tx_frame_count - 1 - i));
+  }
+
+  auto event_fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (event_fd < 0) {
+    callbacks_.on_error("open", make_error(errno));
+    return false;
+  }
+  event_fd_.assign(event_fd);
+
+  if (auto ret = io_uring_register_eventfd(&ring_, event_fd); ret < 0) {
+    callbacks_.on_error("open", make_error(-ret));
+    return false;
+  }
+  return true;
+}
+
+void J1939UringConnection::Start()
+{
+  if (callbacks_.on_start) { callbacks_.on_start(this); }
+  assert(callbacks_.on_read);
+  assert(callbacks_.on_error);
+  boost::asio::post(strand_, [self = shared_from_this()]() {
+    self->ArmRead();
+    io_uring_submit(&self->ring_);
+    self->Wait();
+  });
+}
+
+void J1939UringConnection::SendRaw(const jay::frame &j1939_frame)
+{
+  boost::asio::post(strand_, [j1939_frame, self = shared_from_this()]() {
+    self->queue_.push(j1939_frame);
+
+    // Are we already waiting for tx slots to be freed?
+    if (self->tx_free_.empty()) { return; }
+
+    self->Write();
+  });
+}
+
+void J1939UringConnection::SendBroadcast(jay::frame &j1939_frame)
+{
+  if (!j1939_frame.header.is_broadcast()) { throw std::invalid_argument("Not a broadcast frame"); }
+
+  if (!local_name_.has_value()) { throw std::invalid_argument("Socket has no local name"); }
+
+  auto source_address = network_.get_address(*local_name_);
+  if (source_address == J1939_IDLE_ADDR) { throw std::invalid_argument("Socket has no source address"); }
+
+  j1939_frame.header.source_adderess(source_address);
+  return SendRaw(j1939_frame);
+}
+
+void J1939UringConnection::Send(jay::frame &j1939_frame)
+{
+  if (!target_name_.has_value()) { throw std::invalid_argument("Socket has no connection name"); }
+
+  return SendTo(*target_name_, j1939_frame);
+}
+
+void J1939UringConnection::SendTo(const uint64_t destination, jay::frame &j1939_frame)
+{
+  if (!local_name_.has_value()) { throw std::invalid_argument("Socket has no local name"); }
+
+  auto source_address = network_.get_address(*local_name_);
+  if (source_address == J1939_IDLE_ADDR) { throw std::invalid_argument("Socket has no source address"); }
+
+  auto destination_address = network_.get_address(destination);
+  if (destination_address == J1939_IDLE_ADDR) { throw std::invalid_argument("Destination has no address"); }
+
+  j1939_frame.header.source_adderess(source_address);
+  j1939_frame.header.pdu_specific(destination_address);
+
+  return SendRaw(j1939_frame);
+}
+
+void J1939UringConnection::OnError(char const *what, boost::system::error_code ec)
+{
+  // Don't report on canceled operations
+  if (ec == boost::asio::error::operation_aborted) { return; }
+
+  callbacks_.on_error(what, ec);
+}
+
+void J1939UringConnection::ArmRead()
+{
+  auto *sqe = io_uring_get_sqe(&ring_);
+  if (!sqe) {
+    io_uring_submit(&ring_);
+    sqe = io_uring_get_sqe(&ring_);
+  }
+  io_uring_prep_recvmsg_multishot(sqe, socket_fd_, &rx_message_, 0);
+  sqe->flags |= IOSQE_BUFFER_SELECT;
+  sqe->buf_group = rx_group_id;
+  io_uring_sqe_set_data64(sqe, rx_tag);
+}
+
+void J1939UringConnection::Wait()
+{
+  event_fd_.async_read_some(boost::asio::buffer(&event_count_, sizeof(event_count_)),
+    [self{ shared_from_this() }](auto error, auto) {
+      if (error) { return self->OnError("wait", error); }
+      self->Reap();
+      self->Wait();
+    });
+}
+
+void J1939UringConnection::Reap()
+{
+  auto mask = io_uring_buf_ring_mask(rx_frame_count);
+  unsigned head{};
+  unsigned count{};
+  unsigned recycled{};
+  bool rearm{ false };
+  io_uring_cqe *cqe{};
+
+  io_uring_for_each_cqe(&ring_, head, cqe)
+  {
+    count++;
+    auto data = io_uring_cqe_get_data64(cqe);
+
+    if (data == rx_tag) {
+      // Multishot recvmsg is disarmed when it stops setting the more flag
+      if (!(cqe->flags & IORING_CQE_F_MORE)) { rearm = true; }
+
+      if (cqe->res < 0) {
+        // Ran out of buffers, they are recycled bellow so just rearm
+        if (cqe->res != -ENOBUFS) { OnError("read", make_error(-cqe->res)); }
+        continue;
+      }
+
+      if (!(cqe->flags & IORING_CQE_F_BUFFER)) { continue; }
+      auto id = static_cast<unsigned short>(cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+      auto *buffer = rx_buffers_[id].data();
+
+      if (auto *out = io_uring_recvmsg_validate(buffer, cqe->res, &rx_message_)) {
+        for (auto *control = io_uring_recvmsg_cmsg_firsthdr(out, &rx_message_); control != nullptr;
+             control = io_uring_recvmsg_cmsg_nexthdr(out, &rx_message_, control)) {
+          if (control->cmsg_level != SOL_SOCKET || control->cmsg_type != SO_RXQ_OVFL) { continue; }
+
+          // The counter is cumulative and wraps, so only the difference is added
+          std::uint32_t drops{};
+          std::memcpy(&drops, CMSG_DATA(control), sizeof(drops));
+          kernel_drops_.fetch_add(static_cast<std::uint32_t>(drops - last_drops_), std::memory_order_relaxed);
+          last_drops_ = drops;
+        }
+
+        // Trigger callback with frame if we are supposed to get the frame
+        auto &frame = *static_cast<jay::frame *>(io_uring_recvmsg_payload(out, &rx_message_));
+        if (io_uring_recvmsg_payload_length(out, cqe->res, &rx_message_) == sizeof(jay::frame)
+            && CheckAddress(frame)) {
+          callbacks_.on_read(frame);
+        }
+      }
+
+      // Give buffer back to the kernel
+      io_uring_buf_ring_add(rx_ring_, buffer, rx_buffer_size, id, mask, recycled++);
+      continue;
+    }
+
+    if ((data & ~slot_mask) == tx_tag) {
+      auto slot = static_cast<std::uint16_t>(data & slot_mask);
+      tx_free_.push_back(slot);
+
+      if (cqe->res < 0) {
+        OnError("write", make_error(-cqe->res));
+        continue;
+      }
+
+      // Callback with data sent
+      if (callbacks_.on_send) { callbacks_.on_send(tx_frames_[slot]); }
+    }
+  }
+
+  io_uring_cq_advance(&ring_, count);
+  if (recycled > 0) { io_uring_buf_ring_advance(rx_ring_, static_cast<int>(recycled)); }
+  if (rearm) { ArmRead(); }
+
+  // Send the next messages if any, this also submits the rearmed recv
+  if (!queue_.empty() && !tx_free_.empty()) { return Write(); }
+  if (rearm) { io_uring_submit(&ring_); }
+}
+
+void J1939UringConnection::Write()
+{
+  while (!queue_.empty() && !tx_free_.empty()) {
+    auto *sqe = io_uring_get_sqe(&ring_);
+    if (!sqe) { break; }
+
+    auto slot = tx_free_.back();
+    tx_free_.pop_back();
+    tx_frames_[slot] = queue_.front();
+    queue_.pop();
+
+    // All tx frames live in registered buffer 0
+    io_uring_prep_write_fixed(sqe, socket_fd_, &tx_frames_[slot], sizeof(jay::frame), 0, 0);
+    io_uring_sqe_set_data64(sqe, tx_tag | slot);
+  }
+
+  // One syscall for the whole batch
+  io_uring_submit(&ring_);
+}
+
+/**
+ * @note Mirrors J1939Connection::CheckAddress, frames are checked in place in the buffer ring
+ */
+bool J1939UringConnection::CheckAddress(const jay::frame &frame) const
+{
+  /// If we dont have any names then accept any frame
+  if (!target_name_ && !local_name_) { return true; }
+
+  // We can accept broadcasts from target is there is one
+  if (frame.header.is_broadcast()) {
+    if (target_name_) { return network_.get_address(*target_name_) == frame.header.source_adderess(); }
+    return true;
+  }
+
+  // If we have both target and local name then
+  // check source and target address, given its not a broadcast
+  if (target_name_ && local_name_) {
+    return network_.get_address(*target_name_) == frame.header.source_adderess()
+           && network_.get_address(*local_name_) == frame.header.pdu_specific();
+  }
+
+  // If message is for local name, but we dont care who its from
+  if (!target_name_ && local_name_) { return network_.get_address(*local_name_) == frame.header.pdu_specific(); }
+
+  // Check that the message is from our intended target but we dont care if its for us
+  if (target_name_ && !local_name_) { return network_.get_address(*target_name_) == frame.header.source_adderess(); }
+
+  return false;
+}
@@ -0,0 +1,300 @@
+//
+// Copyright (c) 2022 Bjørn Fuglestad, Jaersense AS (bjorn@jaersense.no)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/bjorn-jaes/jay
+//
+
+#ifndef J1939_URING_CONNECTION_H
+#define J1939_URING_CONNECTION_H
+
+#pragma once
+
+// C++
+#include <array>
+#include <atomic>
+#include <functional>
+#include <optional>
+#include <queue>
+#include <vector>
+
+// Linux
+#include <liburing.h>
+#include <sys/socket.h>
+
+// Libraries
+#include "boost/asio.hpp"
+
+#include "canary/filter.hpp"
+
+#include "jay/frame.hpp"
+#include "jay/network.hpp"
+
+// Local
+
+/**
+ * J1939 Connection analog that uses io_uring instead of the asio epoll reactor
+ *
+ * A single multishot recvmsg is kept armed on the socket and fills frames directly into
+ * a provided buffer ring, so reading does not need a readiness notification and a
+ * syscall per frame. The control data in front of every frame carries the kernel drop
+ * counter. Outgoing frames are copied into a registered frame array and
+ * all frames waiting in the queue are submitted as one batch of fixed buffer writes.
+ * Completions are signaled through an eventfd that is waited on by asio, so the
+ * connection runs on the same io_context as the rest of the application.
+ * @note The connection manages its own lifetime
+ * @note Requires linux 6.0 and liburing 2.4 or newer
+ */
+class J1939UringConnection : public std::enable_shared_from_this<J1939UringConnection>
+{
+public:
+  /**
+   * @brief Struct containing callbacks for J1939UringConnection
+   */
+  struct Callbacks
+  {
+    // Alias
+    using J1939OnSelf = std::function<void(J1939UringConnection *)>;
+    using J1939OnError = std::function<void(const std::string, const boost::system::error_code)>;
+    using J1939OnFrame = std::function<void(jay::frame)>;
+
+    /**
+     * @brief Callback for when connection is stated
+     * @note is optional
+     */
+    J1939OnSelf on_start;
+
+    /**
+     * @brief Callback for when connection is destroyed
+     * @note is optional
+     */
+    J1939OnSelf on_destroy;
+
+    /**
+     * @brief Callback for when data is recieved
+     * @note is required
+     */
+    J1939OnFrame on_read;
+
+    /**
+     * @brief Callback for when data is sent
+     * @note is optional
+     */
+    J1939OnFrame on_send;
+
+    /**
+     * @brief Callback for when an error occurs
+     *
+     * Constains a string indicating where the error happened and
+     * an error code detailing the error.
+     * @note is required
+     */
+    J1939OnError on_error;
+  };
+
+  /// Number of frames in the receive buffer ring, must be a power of 2
+  static constexpr std::size_t rx_frame_count = 256;
+
+  /// Size of a receive buffer, multishot recvmsg places a header and the control data in front of the frame
+  static constexpr std::size_t rx_buffer_size =
+    sizeof(io_uring_recvmsg_out) + CMSG_SPACE(sizeof(std::uint32_t)) + sizeof(jay::frame);
+
+  /// Number of frames that can be in flight to the socket at once
+  static constexpr std::size_t tx_frame_count = 64;
+
+  /**
+   * @brief Construct a new J1939UringConnection object
+   *
+   * @param io_context for performing async io operation
+   * @param network containing address name pairs
+   */
+  J1939UringConnection(boost::asio::io_context &io_context, const jay::network &network);
+
+  /**
+   * @brief Construct a new J1939UringConnection object
+   *
+   * @param io_context for performing async io operation
+   * @param network containing address name pairs
+   * @param callbacks for generated events
+   */
+  J1939UringConnection(boost::asio::io_context &io_context, const jay::network &network, Callbacks &&callbacks);
+
+  /**
+   * @brief Construct a new J1939UringConnection object
+   *
+   * @param io_context for performing async io operation
+   * @param network containing address name pairs
+   * @param callbacks for generated events
+   * @param local_name that this connection is sending messages from
+   * @param target_name that this connection is sending messages to
+   */
+  J1939UringConnection(boost::asio::io_context &io_context,
+    const jay::network &network,
+    Callbacks &&callbacks,
+    std::optional<jay::name> local_name,
+    std::optional<jay::name> target_name);
+
+  /**
+   * @brief Destroy the J1939UringConnection object
+   */
+  ~J1939UringConnection();
+
+  /**
+   * @brief Open the socket and set up the io_uring instance
+   * @param filters for incomming j1939 messages
+   * @return true if opened endpoint
+   * @return false if failed to open endpoint
+   */
+  bool Open(const std::vector<canary::filter> &filters);
+
+  /**
+   * Listen for incomming j1939 frames
+   */
+  void Start();
+
+  /// ##################### Set/Get ##################### ///
+
+  /**
+   * @brief Set the Callbacks object
+   * @param callbacks
+   */
+  void SetCallbacks(Callbacks &&callbacks) { callbacks_ = std::move(callbacks); }
+
+  /**
+   * @brief Set the local j1939 name
+   * @param name of the device this connection is sending
+   * messages from, used for setting source address in messages
+   */
+  void SetLocalName(jay::name name) { local_name_ = name; }
+
+  /**
+   * @brief Set the Target Name object
+   * @param name of the device this connection is sending
+   * messages to, used for setting destination address in messages
+   */
+  void SetTargetName(jay::name name) { target_name_ = name; }
+
+  /**
+   * Get local name on this connection
+   * @return optional name, is null_opt if none was set
+   */
+  std::optional<jay::name> GetLocalName() const { return local_name_; }
+
+  /**
+   * Get target name on this connection
+   * @return optional name, is null_opt if none was set
+   */
+  std::optional<jay::name> GetTargeName() const { return target_name_; }
+
+  /**
+   * @brief Get the Network reference
+   * @return jay::network&
+   */
+  const jay::network &GetNetwork() const { return network_; }
+
+  /**
+   * @brief Get the number of frames dropped by the kernel as the receive buffer was full
+   * @return drops reported with SO_RXQ_OVFL since the socket was opened
+   * @note is safe to call from any thread
+   */
+  std::uint64_t KernelDrops() const { return kernel_drops_.load(std::memory_order_relaxed); }
+
+  /// ##################### WRITE ##################### ///
+
+  /**
+   * Send a frame to socket without any checks
+   * @param j1939_frame that will be sent
+   */
+  void SendRaw(const jay::frame &j1939_frame);
+
+  /**
+   * Send a broadcast frame to the socket
+   * @param j1939_frame that will be broadcast, the source address
+   * is set by the socket
+   * @throw std::invalid_argument if frame does not contain a
+   * broadcast PDU_S or there is if the socket does not have
+   * and address
+   */
+  void SendBroadcast(jay::frame &j1939_frame);
+
+  /**
+   * Send frame to connected controller application
+   * @param j1939_frame that will be sent, both source address
+   * and PDU specifier is set by the socket
+   * @throw std::invalid_argument if no connected controller
+   * app name has been set
+   */
+  void Send(jay::frame &j1939_frame);
+
+  /**
+   * Send frame to specific controller application
+   * @param destination - name of the controller application to send to
+   * @param j1939_frame that will be sent, both source address
+   * and PDU specifier is set by the socket
+   * @throw std::invalid_argument if source and destination addresses
+   * are not available
+   */
+  void SendTo(const uint64_t destination, jay::frame &j1939_frame);
+
+private:
+  /**
+   * @brief Called when an event failes
+   * @param what failed
+   * @param ec for the error
+   */
+  void OnError(char const *what, boost::system::error_code ec);
+
+  /**
+   * Arm the multishot recvmsg on the socket
+   */
+  void ArmRead();
+
+  /**
+   * Wait for the eventfd to signal that completions are ready
+   */
+  void Wait();
+
+  /**
+   * Process all completions in the completion queue
+   */
+  void Reap();
+
+  /**
+   * Copy queued frames into free tx slots and submit them as one batch
+   */
+  void Write();
+
+  bool CheckAddress(const jay::frame &frame) const;
+
+private:
+  // Injected
+
+  boost::asio::strand<boost::asio::io_context::executor_type> strand_; /**< Strand serializing all ring access */
+  const jay::network &network_; /**< Network reference for querying network for addresses */
+  Callbacks callbacks_; /**< Callbacks for generated events */
+
+  std::optional<jay::name> local_name_{}; /**< Optional local j1939 name */
+  std::optional<jay::name> target_name_{}; /**< Optional targeted j1939 name */
+
+  // Internal
+
+  int socket_fd_{ -1 }; /**< raw CAN-bus socket */
+  io_uring ring_{}; /**< io_uring instance */
+  bool ring_open_{ false }; /**< If ring_ has been initialized */
+  io_uring_buf_ring *rx_ring_{ nullptr }; /**< Provided buffer ring backed by rx_buffers_ */
+  msghdr rx_message_{}; /**< Layout of the multishot recvmsg buffers, only the control length is set */
+  boost::asio::posix::stream_descriptor event_fd_; /**< Completion notification eventfd */
+  std::uint64_t event_count_{}; /**< Buffer for reading eventfd */
+
+  alignas(jay::frame) std::array<std::array<std::uint8_t, rx_buffer_size>, rx_frame_count>
+    rx_buffers_{}; /**< Incomming frame buffers */
+  std::array<jay::frame, tx_frame_count> tx_frames_{}; /**< Registered outgoing frame buffers */
+  std::vector<std::uint16_t> tx_free_{}; /**< Free slots in tx_frames_ */
+  std::queue<jay::frame> queue_{}; /**< Outgoing frame queue */
+  std::uint32_t last_drops_{}; /**< Last SO_RXQ_OVFL counter, it wraps at 2^32 */
+  std::atomic<std::uint64_t> kernel_drops_{}; /**< Kernel drops since the socket was opened */
+};
+
+#endif
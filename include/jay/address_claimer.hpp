@@ -22,6 +22,7 @@
 #include "frame.hpp"
 #include "name.hpp"
 #include "network.hpp"
+#include "probes.hpp"
 
 
 namespace jay {
@@ -346,6 +347,7 @@ private:
    */
   void send_address_claim(std::uint8_t address) const
   {
+    JAY_PROBE(claim_send, J1939_PGN_ADDRESS_CLAIMED, address, 6, name_);
     if (callbacks_.on_address_claim) { callbacks_.on_address_claim(name_, address); }
   }
 
@@ -356,6 +358,7 @@ private:
    */
   void begin_claiming_address(st_claiming &claiming, const network &network) const
   {
+    JAY_PROBE(claim_begin, J1939_PGN_ADDRESS_CLAIMED, claiming.address, 6, name_);
     if (callbacks_.on_begin_claiming) { callbacks_.on_begin_claiming(); }
     claim_address(claiming, network);
   }
@@ -389,6 +392,7 @@ private:
    */
   void send_cannot_claim() const
   {
+    JAY_PROBE(cannot_claim, J1939_PGN_ADDRESS_CLAIMED, J1939_IDLE_ADDR, 6, name_);
     if (callbacks_.on_cannot_claim) { callbacks_.on_cannot_claim(name_); }
   }
 
@@ -398,6 +402,7 @@ private:
    */
   void notify_address_gain(st_has_address &has_address)
   {
+    JAY_PROBE(address_gain, J1939_PGN_ADDRESS_CLAIMED, has_address.address, 6, name_);
     if (callbacks_.on_address) { callbacks_.on_address(name_, has_address.address); }
   };
 
@@ -406,6 +411,7 @@ private:
    */
   void notify_address_loss()
   {
+    JAY_PROBE(address_loss, J1939_PGN_ADDRESS_CLAIMED, J1939_IDLE_ADDR, 6, name_);
     if (callbacks_.on_lose_address) { callbacks_.on_lose_address(name_); }
   };
 
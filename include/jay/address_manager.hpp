@@ -23,6 +23,7 @@
 
 // Local
 #include "address_claimer.hpp"
+#include "stage_histogram.hpp"
 
 namespace jay {
 
@@ -123,7 +124,10 @@ public:
    */
   void address_request(jay::address_claimer::ev_address_request request)
   {
-    boost::asio::post(context_, [this, request]() -> void { state_machine_.process_event(request); });
+    boost::asio::post(context_, [this, request, timer = jay::stage_timer{}]() -> void {
+      state_machine_.process_event(request);
+      timer.record(jay::stage::address_event);
+    });
   }
 
   /**
@@ -133,7 +137,10 @@ public:
    */
   void address_claim(jay::address_claimer::ev_address_claim claim)
   {
-    boost::asio::post(context_, [this, claim]() -> void { state_machine_.process_event(claim); });
+    boost::asio::post(context_, [this, claim, timer = jay::stage_timer{}]() -> void {
+      state_machine_.process_event(claim);
+      timer.record(jay::stage::address_event);
+    });
   }
 
 private:
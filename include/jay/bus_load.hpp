@@ -0,0 +1,408 @@
+//
+// Copyright (c) 2022 Bjørn Fuglestad, Jaersense AS (bjorn@jaersense.no)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/bjorn-jaes/jay
+//
+
+#ifndef JAY_BUS_LOAD_H
+#define JAY_BUS_LOAD_H
+
+#pragma once
+
+// C++
+#include <algorithm>//std::min, std::partial_sort
+#include <array>//std::array
+#include <atomic>//std::atomic
+#include <chrono>//std::chrono::steady_clock
+#include <cstdint>//std::uint32_t, std::uint64_t
+#include <memory>//std::unique_ptr
+#include <utility>//std::pair
+#include <vector>//std::vector
+
+// Local
+#include "frame.hpp"// jay::frame
+
+namespace jay {
+
+namespace detail {
+
+/**
+ * @internal
+ * @brief Make the table for updating the CAN CRC-15 a byte at a time
+ * @return CRC of every byte shifted through a zero CRC
+ */
+constexpr std::array<std::uint16_t, 256> make_crc15_table() noexcept
+{
+  std::array<std::uint16_t, 256> table{};
+  for (std::uint32_t byte = 0; byte < 256; byte++) {
+    auto crc = byte << 7;
+    for (int i = 0; i < 8; i++) { crc = (crc & 0x4000) != 0 ? (crc << 1) ^ 0x4599 : crc << 1; }
+    table[byte] = static_cast<std::uint16_t>(crc & 0x7FFF);
+  }
+  return table;
+}
+
+/**
+ * @internal
+ * @brief Make the table for counting stuff bits a byte at a time
+ *
+ * The state is the last bit and the length of its run, 5 * last + run. An entry holds
+ * the stuff bits inserted in the byte in the high nibble and the next state in the low.
+ * @return entry for every state and byte
+ */
+constexpr std::array<std::array<std::uint8_t, 256>, 10> make_stuff_table() noexcept
+{
+  std::array<std::array<std::uint8_t, 256>, 10> table{};
+  for (std::uint32_t state = 0; state < 10; state++) {
+    for (std::uint32_t byte = 0; byte < 256; byte++) {
+      auto last = state / 5;
+      auto run = state % 5;
+      std::uint32_t stuff{ 0 };
+      for (std::uint32_t i = 8; i > 0; i--) {
+        auto bit = (byte >> (i - 1)) & 1;
+        run = bit == last ? run + 1 : 1;
+        last = bit;
+        if (run == 5) {
+          // The stuff bit is the complement and starts the next run
+          stuff++;
+          last ^= 1;
+          run = 1;
+        }
+      }
+      table[state][byte] = static_cast<std::uint8_t>((stuff << 4) | (5 * last + run));
+    }
+  }
+  return table;
+}
+
+inline constexpr auto crc15_table = make_crc15_table();
+inline constexpr auto stuff_table = make_stuff_table();
+
+}// namespace detail
+
+/**
+ * @brief Get the number of bits an extended data frame occupies on the bus
+ *
+ * Counts start of frame through the CRC sequence with the stuff bits that are inserted
+ * after every five equal bits, which depend on the identifier, payload and CRC, plus
+ * the unstuffed CRC delimiter, acknowledge, end of frame and the 3 bit intermission.
+ * The CRC and stuff bits are counted a byte at a time with lookup tables.
+ * @param frame to measure
+ * @return bits, 131 to 160 for a frame with 8 bytes of payload
+ */
+constexpr std::uint32_t frame_bits(const jay::frame &frame) noexcept
+{
+  auto id = frame.header.id();
+  auto length = std::min<std::uint32_t>(static_cast<std::uint32_t>(frame.header.payload_length()), 8);
+
+  // Start of frame, identifier, SRR, IDE, RTR, reserved bits and length are 39 bits
+  std::uint64_t header = (std::uint64_t{ id >> 18 } << 27) | (std::uint64_t{ 0b11 } << 25)
+                         | (std::uint64_t{ id & 0x3'FFFF } << 7) | length;
+
+  std::uint32_t crc{ 0 };
+  std::uint32_t state{ 0 };
+  std::uint32_t stuff{ 0 };
+  auto crc_byte = [&](std::uint32_t byte) {
+    crc = ((crc << 8) ^ detail::crc15_table[((crc >> 7) ^ byte) & 0xFF]) & 0x7FFF;
+  };
+  auto stuff_byte = [&](std::uint32_t byte) {
+    auto entry = detail::stuff_table[state][byte];
+    stuff += entry >> 4;
+    state = entry & 0xFU;
+  };
+
+  // A leading bit aligns the header to 5 bytes. It is 0 for the CRC, which leaves a zero CRC
+  // unchanged, and 1 for stuffing, which starts from a run of 0 so start of frame begins a new run
+  for (std::uint32_t i = 5; i > 0; i--) {
+    auto byte = static_cast<std::uint32_t>(header >> (8 * (i - 1))) & 0xFF;
+    crc_byte(byte);
+    stuff_byte(i == 5 ? byte | 0x80 : byte);
+  }
+  for (std::uint32_t i = 0; i < length; i++) {
+    crc_byte(frame.payload[i]);
+    stuff_byte(frame.payload[i]);
+  }
+
+  // A trailing bit aligns the CRC sequence to 2 bytes, the complement of the last bit can not complete a run
+  auto sequence = (crc << 1) | (~crc & 1);
+  stuff_byte(sequence >> 8);
+  stuff_byte(sequence & 0xFF);
+
+  // 39 header bits, data and 15 bit CRC are stuffed, followed by 1 + 2 + 7 + 3 fixed bits
+  return 39 + 8 * length + 15 + stuff + 13;
+}
+
+/**
+ * @brief Measures bus load from frames seen on the bus, in total, per source address and per PGN
+ *
+ * Frames are counted in a ring of time buckets covering a sliding window. Counters are
+ * atomics in memory allocated by the constructor, so record does not lock or allocate
+ * and can be called from the receive path of several connections on the same bus. PGNs
+ * are tracked in a fixed size table, frames of PGNs that do not fit are only counted in
+ * the totals and as overflow.
+ * @note Frames recorded by another thread while a bucket is rolled over may be lost from
+ * the counts, which is accepted for a monitor
+ */
+class bus_load_monitor
+{
+public:
+  using clock = std::chrono::steady_clock;
+
+  /// Number of buckets the window is divided into
+  static constexpr std::size_t buckets{ 10 };
+
+  /// Number of distinct PGNs that are tracked
+  static constexpr std::size_t pgn_capacity{ 512 };
+
+  /**
+   * @brief Use of the bus over the window
+   */
+  struct usage
+  {
+    std::uint64_t frames{}; /**< Frames in the window */
+    std::uint64_t bits{}; /**< Bits in the window, @see frame_bits */
+    double load{}; /**< Percent of the bitrate used */
+    double frames_per_second{}; /**< Frame rate */
+  };
+
+  /**
+   * @brief Use of the bus by a source address or PGN
+   */
+  struct talker
+  {
+    std::uint32_t id{}; /**< Source address or PGN */
+    std::uint64_t frames{}; /**< Frames in the window */
+    std::uint64_t bits{}; /**< Bits in the window */
+    double load{}; /**< Percent of the bitrate used */
+  };
+
+  /**
+   * @brief Construct a bus load monitor
+   * @param bitrate of the bus in bits/s, 250 kbit/s is the J1939-11 rate
+   * @param window length of the sliding window, divided into buckets
+   */
+  explicit bus_load_monitor(std::uint32_t bitrate = 250000, clock::duration window = std::chrono::seconds(1))
+    : bitrate_(bitrate), bucket_length_(std::max(window / static_cast<clock::rep>(buckets), clock::duration{ 1 })),
+      buckets_(std::make_unique<bucket[]>(buckets)),
+      pgns_(std::make_unique<std::atomic<std::uint32_t>[]>(pgn_capacity))
+  {
+    for (std::size_t i = 0; i < pgn_capacity; i++) { pgns_[i].store(empty_pgn, std::memory_order_relaxed); }
+  }
+
+  /**
+   * @brief Count a frame seen on the bus
+   * @param frame read from the bus or echoed after it was sent
+   * @param now time the frame was on the bus
+   * @note is lock free and safe to call from any thread
+   */
+  void record(const jay::frame &frame, clock::time_point now = clock::now()) noexcept
+  {
+    auto tick = now.time_since_epoch() / bucket_length_;
+    auto &current = buckets_[static_cast<std::size_t>(tick) % buckets];
+    auto epoch = current.epoch.load(std::memory_order_acquire);
+    if (epoch > tick) { return; }
+    if (epoch < tick && current.epoch.compare_exchange_strong(epoch, tick, std::memory_order_acq_rel)) {
+      current.reset();
+    }
+
+    auto bits = frame_bits(frame);
+    current.total.add(bits);
+    current.sources[frame.header.source_adderess()].add(bits);
+
+    auto slot = find_pgn(frame.header.pgn());
+    if (slot < pgn_capacity) {
+      current.pgns[slot].add(bits);
+    } else {
+      pgn_overflow_.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  /**
+   * @brief Get the use of the whole bus
+   * @param now end of the window
+   * @return usage over the window
+   */
+  usage get_usage(clock::time_point now = clock::now()) const noexcept
+  {
+    auto [frames, bits] = sum(now, [](const bucket &b) -> const counter & { return b.total; });
+    auto span = seconds(now);
+    return usage{ frames, bits, to_load(bits, span), span > 0.0 ? static_cast<double>(frames) / span : 0.0 };
+  }
+
+  /**
+   * @brief Get the use of the bus by a source address
+   * @param address to get use of
+   * @param now end of the window
+   * @return usage over the window
+   */
+  usage get_source_usage(std::uint8_t address, clock::time_point now = clock::now()) const noexcept
+  {
+    auto [frames, bits] = sum(now, [address](const bucket &b) -> const counter & { return b.sources[address]; });
+    auto span = seconds(now);
+    return usage{ frames, bits, to_load(bits, span), span > 0.0 ? static_cast<double>(frames) / span : 0.0 };
+  }
+
+  /**
+   * @brief Get the source addresses using the most of the bus
+   * @param count of source addresses to get
+   * @param now end of the window
+   * @return up to count source addresses that sent frames, most bits first
+   */
+  std::vector<talker> top_sources(std::size_t count, clock::time_point now = clock::now()) const
+  {
+    std::vector<talker> talkers{};
+    auto span = seconds(now);
+    for (std::uint32_t address = 0; address < 256; address++) {
+      auto [frames, bits] = sum(now, [address](const bucket &b) -> const counter & { return b.sources[address]; });
+      if (frames > 0) { talkers.push_back(talker{ address, frames, bits, to_load(bits, span) }); }
+    }
+    return top(std::move(talkers), count);
+  }
+
+  /**
+   * @brief Get the PGNs using the most of the bus
+   * @param count of PGNs to get
+   * @param now end of the window
+   * @return up to count PGNs that were sent, most bits first
+   */
+  std::vector<talker> top_pgns(std::size_t count, clock::time_point now = clock::now()) const
+  {
+    std::vector<talker> talkers{};
+    auto span = seconds(now);
+    for (std::size_t slot = 0; slot < pgn_capacity; slot++) {
+      auto pgn = pgns_[slot].load(std::memory_order_relaxed);
+      if (pgn == empty_pgn) { continue; }
+      auto [frames, bits] = sum(now, [slot](const bucket &b) -> const counter & { return b.pgns[slot]; });
+      if (frames > 0) { talkers.push_back(talker{ pgn, frames, bits, to_load(bits, span) }); }
+    }
+    return top(std::move(talkers), count);
+  }
+
+  /**
+   * @brief Get the number of frames whose PGN did not fit in the PGN table
+   * @return frames only counted in the totals and per source address
+   */
+  std::uint64_t pgn_overflow() const noexcept { return pgn_overflow_.load(std::memory_order_relaxed); }
+
+private:
+  static constexpr std::uint32_t empty_pgn{ 0xFFFF'FFFF };
+
+  /**
+   * @internal
+   * @brief Frames and bits counted in a bucket
+   */
+  struct counter
+  {
+    std::atomic<std::uint64_t> frames{ 0 };
+    std::atomic<std::uint64_t> bits{ 0 };
+
+    void add(std::uint32_t frame_bits) noexcept
+    {
+      frames.fetch_add(1, std::memory_order_relaxed);
+      bits.fetch_add(frame_bits, std::memory_order_relaxed);
+    }
+
+    void reset() noexcept
+    {
+      frames.store(0, std::memory_order_relaxed);
+      bits.store(0, std::memory_order_relaxed);
+    }
+  };
+
+  /**
+   * @internal
+   * @brief Counters of one bucket length of time
+   */
+  struct bucket
+  {
+    std::atomic<clock::rep> epoch{ -1 }; /**< Tick the counters belong to */
+    counter total{};
+    std::array<counter, 256> sources{};
+    std::array<counter, pgn_capacity> pgns{};
+
+    void reset() noexcept
+    {
+      total.reset();
+      for (auto &source : sources) { source.reset(); }
+      for (auto &pgn : pgns) { pgn.reset(); }
+    }
+  };
+
+  /**
+   * @internal
+   * @brief Find or claim the slot of a PGN with linear probing
+   * @return slot, or pgn_capacity if the table is full
+   */
+  std::size_t find_pgn(pgn_t pgn) noexcept
+  {
+    auto start = static_cast<std::size_t>((pgn * 0x9E37'79B1U) >> 23) % pgn_capacity;
+    for (std::size_t i = 0; i < pgn_capacity; i++) {
+      auto slot = (start + i) % pgn_capacity;
+      auto key = pgns_[slot].load(std::memory_order_relaxed);
+      if (key == pgn) { return slot; }
+      if (key == empty_pgn) {
+        if (pgns_[slot].compare_exchange_strong(key, pgn, std::memory_order_relaxed) || key == pgn) { return slot; }
+      }
+    }
+    return pgn_capacity;
+  }
+
+  /**
+   * @internal
+   * @brief Sum a counter over the buckets in the window ending at now
+   */
+  template<typename Select>
+  std::pair<std::uint64_t, std::uint64_t> sum(clock::time_point now, Select select) const noexcept
+  {
+    auto tick = now.time_since_epoch() / bucket_length_;
+    std::uint64_t frames{ 0 };
+    std::uint64_t bits{ 0 };
+    for (std::size_t i = 0; i < buckets; i++) {
+      auto &b = buckets_[i];
+      auto epoch = b.epoch.load(std::memory_order_acquire);
+      if (epoch > tick || epoch <= tick - static_cast<clock::rep>(buckets)) { continue; }
+      auto &count = select(b);
+      frames += count.frames.load(std::memory_order_relaxed);
+      bits += count.bits.load(std::memory_order_relaxed);
+    }
+    return { frames, bits };
+  }
+
+  /**
+   * @internal
+   * @brief Length of the window ending at now in seconds, the current bucket is only partly filled
+   */
+  double seconds(clock::time_point now) const noexcept
+  {
+    auto partial = now.time_since_epoch() % bucket_length_;
+    return std::chrono::duration<double>(bucket_length_ * static_cast<clock::rep>(buckets - 1) + partial).count();
+  }
+
+  double to_load(std::uint64_t bits, double span) const noexcept
+  {
+    return span > 0.0 ? 100.0 * static_cast<double>(bits) / (span * static_cast<double>(bitrate_)) : 0.0;
+  }
+
+  static std::vector<talker> top(std::vector<talker> talkers, std::size_t count)
+  {
+    count = std::min(count, talkers.size());
+    auto end = talkers.begin() + static_cast<std::ptrdiff_t>(count);
+    std::partial_sort(talkers.begin(), end, talkers.end(), [](auto &lhs, auto &rhs) { return lhs.bits > rhs.bits; });
+    talkers.resize(count);
+    return talkers;
+  }
+
+private:
+  std::uint32_t bitrate_;
+  clock::duration bucket_length_;
+  std::unique_ptr<bucket[]> buckets_; /**< Ring of buckets indexed by tick modulo buckets */
+  std::unique_ptr<std::atomic<std::uint32_t>[]> pgns_; /**< PGN of each slot in the bucket PGN counters */
+  std::atomic<std::uint64_t> pgn_overflow_{ 0 };
+};
+
+}// namespace jay
+
+#endif
@@ -0,0 +1,179 @@
+//
+// Copyright (c) 2022 Bjørn Fuglestad, Jaersense AS (bjorn@jaersense.no)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/bjorn-jaes/jay
+//
+
+#ifndef JAY_CHANGE_FILTER_H
+#define JAY_CHANGE_FILTER_H
+
+#pragma once
+
+// C++
+#include <atomic>//std::atomic
+#include <chrono>//std::chrono::steady_clock
+#include <cstdint>//std::uint64_t
+#include <unordered_map>//std::unordered_map
+
+// Local
+#include "frame.hpp"// jay::frame
+#include "pgn_codec.hpp"// jay::to_word
+
+namespace jay {
+
+/**
+ * @brief Filter that only lets through frames whose payload changed
+ *
+ * Most cyclic parameter groups repeat the same payload, the filter keeps the last
+ * delivered payload per PGN and source address and compares new frames to it as a
+ * single 64-bit word. Bits that change without carrying information, like message
+ * counters and checksums, can be ignored per PGN. A frame is also let through if
+ * nothing was delivered for the keep-alive period, so consumers can tell a silent
+ * controller from an unchanged one.
+ *
+ * Only broadcast (PDU2) frames are filtered. Peer-to-peer (PDU1) frames, which include
+ * requests, acknowledgements, address claims and the transport protocol, are always
+ * let through as repeating them is meaningful and their PGN does not hold the destination.
+ * @note Is not thread safe, except for get_stats which can be called from any thread
+ */
+class change_filter
+{
+public:
+  using clock = std::chrono::steady_clock;
+
+  /**
+   * @brief Snapshot of filter statistics
+   */
+  struct stats
+  {
+    std::uint64_t frames{}; /**< Frames passed to the filter */
+    std::uint64_t peer_to_peer{}; /**< Peer-to-peer (PDU1) frames, always let through */
+    std::uint64_t changed{}; /**< Frames let through as the payload changed, includes first frames */
+    std::uint64_t keep_alive{}; /**< Unchanged frames let through as the keep-alive period passed */
+    std::uint64_t suppressed{}; /**< Unchanged frames filtered out */
+
+    /**
+     * @brief Get the part of the frames that were filtered out
+     * @return suppressed / frames, 0 if there were no frames
+     */
+    double suppression_rate() const noexcept
+    {
+      return frames > 0 ? static_cast<double>(suppressed) / static_cast<double>(frames) : 0.0;
+    }
+  };
+
+  /**
+   * @brief Construct a change filter
+   * @param keep_alive period after which an unchanged frame is let through, zero to never let them through
+   */
+  explicit change_filter(clock::duration keep_alive = std::chrono::seconds(1)) : keep_alive_(keep_alive) {}
+
+  /**
+   * @brief Ignore payload bits of a PGN when comparing
+   * @param pgn to set mask for
+   * @param mask of payload word bits to ignore, @see jay::to_word
+   */
+  void ignore(pgn_t pgn, std::uint64_t mask)
+  {
+    ignore_masks_[pgn] = mask;
+    for (auto &[key, entry] : entries_) {
+      if ((key >> 8) == pgn) { entry.mask = ~mask; }
+    }
+  }
+
+  /**
+   * @brief Check if a frame should be delivered, and remember it if it is
+   * @param frame that was received
+   * @param now time the frame was received
+   * @return true if the frame is peer-to-peer, the payload changed since the last delivered
+   * frame with the same PGN and source address, or the keep-alive period has passed
+   */
+  bool pass(const jay::frame &frame, clock::time_point now = clock::now())
+  {
+    frames_.fetch_add(1, std::memory_order_relaxed);
+    if (!frame.header.is_broadcast()) {
+      peer_to_peer_.fetch_add(1, std::memory_order_relaxed);
+      return true;
+    }
+
+    auto key = (frame.header.pgn() << 8) | frame.header.source_adderess();
+    auto word = jay::to_word(frame.payload);
+    auto length = static_cast<std::uint8_t>(frame.header.payload_length());
+
+    auto [it, inserted] = entries_.try_emplace(key);
+    auto &entry = it->second;
+    if (inserted) {
+      auto mask = ignore_masks_.find(frame.header.pgn());
+      entry.mask = mask != ignore_masks_.end() ? ~mask->second : ~0ULL;
+    } else if (((entry.word ^ word) & entry.mask) == 0 && entry.length == length) {
+      if (keep_alive_ == clock::duration::zero() || now - entry.delivered < keep_alive_) {
+        suppressed_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      }
+      keep_alive_count_.fetch_add(1, std::memory_order_relaxed);
+      entry.delivered = now;
+      return true;
+    }
+
+    changed_.fetch_add(1, std::memory_order_relaxed);
+    entry.word = word;
+    entry.length = length;
+    entry.delivered = now;
+    return true;
+  }
+
+  /**
+   * @brief Forget all payloads, so the next frame of every PGN and source address is delivered
+   * @note Ignore masks are kept
+   */
+  void clear() { entries_.clear(); }
+
+  /**
+   * @brief Get the number of PGN and source address pairs that are cached
+   * @return cached payloads
+   */
+  std::size_t size() const noexcept { return entries_.size(); }
+
+  /**
+   * @brief Get statistics
+   * @return snapshot of the current statistics
+   */
+  stats get_stats() const noexcept
+  {
+    return stats{ frames_.load(std::memory_order_relaxed),
+      peer_to_peer_.load(std::memory_order_relaxed),
+      changed_.load(std::memory_order_relaxed),
+      keep_alive_count_.load(std::memory_order_relaxed),
+      suppressed_.load(std::memory_order_relaxed) };
+  }
+
+private:
+  /**
+   * @internal
+   * @brief Last delivered payload of a PGN and source address
+   */
+  struct entry
+  {
+    std::uint64_t word{};
+    std::uint64_t mask{}; /**< Bits to compare, inverse of the ignore mask */
+    clock::time_point delivered{};
+    std::uint8_t length{};
+  };
+
+  clock::duration keep_alive_;
+  std::unordered_map<std::uint32_t, entry> entries_{}; /**< Keyed on PGN << 8 | source address */
+  std::unordered_map<pgn_t, std::uint64_t> ignore_masks_{};
+
+  std::atomic<std::uint64_t> frames_{ 0 };
+  std::atomic<std::uint64_t> peer_to_peer_{ 0 };
+  std::atomic<std::uint64_t> changed_{ 0 };
+  std::atomic<std::uint64_t> keep_alive_count_{ 0 };
+  std::atomic<std::uint64_t> suppressed_{ 0 };
+};
+
+}// namespace jay
+
+#endif
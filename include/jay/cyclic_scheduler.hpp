@@ -0,0 +1,364 @@
+//
+// Copyright (c) 2022 Bjørn Fuglestad, Jaersense AS (bjorn@jaersense.no)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/bjorn-jaes/jay
+//
+
+#ifndef JAY_CYCLIC_SCHEDULER_H
+#define JAY_CYCLIC_SCHEDULER_H
+
+#pragma once
+
+// C++
+#include <algorithm>//std::min, std::max, std::stable_sort
+#include <atomic>//std::atomic
+#include <chrono>//std::chrono::steady_clock
+#include <cstdint>//std::uint64_t
+#include <deque>//std::deque
+#include <functional>//std::function
+#include <numeric>//std::lcm
+#include <stdexcept>//std::invalid_argument
+#include <string>//std::string
+#include <utility>//std::pair
+#include <vector>//std::vector
+
+// Lib
+#include "boost/asio/bind_executor.hpp"//boost::asio::bind_executor
+#include "boost/asio/io_context.hpp"//boost::asio::io_context
+#include "boost/asio/post.hpp"//boost::asio::post
+#include "boost/asio/steady_timer.hpp"//boost::asio::steady_timer
+#include "boost/asio/strand.hpp"//boost::asio::strand
+
+// Local
+#include "frame.hpp"
+#include "network.hpp"
+#include "pgn_codec.hpp"// jay::to_word, jay::to_payload
+
+namespace jay {
+
+/**
+ * @brief Sends cyclic parameter groups from one shared timer
+ *
+ * Send times are computed from absolute deadlines, start + phase + n * period, so that
+ * the time spent handling a tick does not add up to drift. When started, every PGN is
+ * given a phase within its period that keeps the number of frames due in the same tick
+ * as low as possible, shortest periods first, which flattens the bus load instead of
+ * sending every PGN on the same millisecond. All frames due in the same tick are passed
+ * to on_frames as one batch.
+ *
+ * Payloads are updated with update, which only stores the payload word in an atomic so
+ * it can be called from any thread at any rate, the latest value is sent.
+ * @note add must be called before the first start, events are handled on a strand of the context
+ */
+class cyclic_scheduler
+{
+public:
+  using clock = std::chrono::steady_clock;
+  using handle = std::size_t;
+
+  /// Granularity of phases and deadlines
+  static constexpr std::chrono::milliseconds resolution{ 1 };
+
+  /// Longest hyperperiod in resolution ticks considered when spreading phases
+  static constexpr std::int64_t max_horizon{ 60000 };
+
+  /**
+   * @brief Callbacks used by the scheduler
+   */
+  struct callbacks
+  {
+    // Called with all frames that are due in the same tick, should be sent as one batch
+    std::function<void(const std::vector<jay::frame> &)> on_frames;
+    // Called when an internal error occurs, used for debugging
+    std::function<void(std::string, const boost::system::error_code &)> on_error;
+  };
+
+  /**
+   * @brief Snapshot of scheduler statistics
+   */
+  struct stats
+  {
+    std::uint64_t ticks{}; /**< Batches passed to on_frames */
+    std::uint64_t frames{}; /**< Frames passed to on_frames */
+    std::uint64_t skipped{}; /**< Periods not sent as the scheduler fell more than a period behind */
+    std::uint64_t no_address{}; /**< Batches not sent as the local controller had no address */
+    std::chrono::nanoseconds max_lateness{}; /**< Longest time from a deadline until its frame was sent */
+  };
+
+  /**
+   * @brief Constructor
+   * @param context from boost asio
+   * @param name of the local controller that frames are sent from
+   * @param network containing name address pairs
+   * @note remember to add callbacks for getting data out of object
+   */
+  cyclic_scheduler(boost::asio::io_context &context, jay::name name, const jay::network &network)
+    : strand_(boost::asio::make_strand(context)), timer_(strand_), name_(name), network_(network)
+  {}
+
+  /**
+   * @brief Constructor with callbacks
+   * @param context from boost asio
+   * @param name of the local controller that frames are sent from
+   * @param network containing name address pairs
+   * @param callbacks for getting data out of object
+   */
+  cyclic_scheduler(boost::asio::io_context &context,
+    jay::name name,
+    const jay::network &network,
+    callbacks &&callbacks)
+    : strand_(boost::asio::make_strand(context)), timer_(strand_), name_(name), network_(network),
+      callbacks_(std::move(callbacks))
+  {}
+
+  /**
+   * @brief set the callbacks for the scheduler
+   * @param callbacks for getting data out of the object
+   */
+  void set_callbacks(callbacks &&callbacks) { callbacks_ = std::move(callbacks); }
+
+  /**
+   * @brief Add a cyclic frame
+   * @param frame to send, the source address is set when it is sent
+   * @param period between frames, rounded down to the resolution
+   * @return handle for updating the payload
+   * @throw std::invalid_argument if the scheduler is started or the period is shorter than the resolution
+   */
+  handle add(const jay::frame &frame, clock::duration period)
+  {
+    if (started_) { throw std::invalid_argument("Cyclic frames must be added before the scheduler is started"); }
+    if (period < resolution) { throw std::invalid_argument("Period is shorter than the scheduler resolution"); }
+    entries_.emplace_back(frame, period - period % resolution);
+    return entries_.size() - 1;
+  }
+
+  /**
+   * @brief Set the payload sent on the next deadline
+   * @param id of the cyclic frame, returned by add
+   * @param payload to send
+   * @note is lock free and safe to call from any thread
+   */
+  void update(handle id, const jay::payload &payload) noexcept
+  {
+    entries_[id].payload.store(jay::to_word(payload), std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Get the phase a cyclic frame was given
+   * @param id of the cyclic frame, returned by add
+   * @return offset from the start of the schedule to the first deadline
+   * @note is set by start
+   */
+  clock::duration get_phase(handle id) const { return entries_[id].phase; }
+
+  /**
+   * @brief Spread the phases and start sending
+   * @note event is posted to context. Can be called again after stop to resume, the
+   * phases are kept and the schedule starts over from the time it is resumed
+   */
+  void start()
+  {
+    if (!started_) {
+      started_ = true;
+      spread_phases();
+    }
+    boost::asio::post(strand_, [this]() -> void {
+      if (!running_) { on_start(); }
+    });
+  }
+
+  /**
+   * @brief Stop sending
+   * @note event is posted to context
+   */
+  void stop()
+  {
+    boost::asio::post(strand_, [this]() -> void {
+      running_ = false;
+      timer_.cancel();
+    });
+  }
+
+  /**
+   * @brief Get statistics
+   * @return snapshot of the current statistics
+   * @note is safe to call from any thread
+   */
+  stats get_stats() const noexcept
+  {
+    return stats{ ticks_.load(std::memory_order_relaxed),
+      frames_.load(std::memory_order_relaxed),
+      skipped_.load(std::memory_order_relaxed),
+      no_address_.load(std::memory_order_relaxed),
+      std::chrono::nanoseconds{ max_lateness_.load(std::memory_order_relaxed) } };
+  }
+
+private:
+  /**
+   * @internal
+   * @brief Cyclic frame and its schedule
+   */
+  struct entry
+  {
+    entry(const jay::frame &cyclic_frame, clock::duration cyclic_period)
+      : frame(cyclic_frame), payload(jay::to_word(cyclic_frame.payload)), period(cyclic_period)
+    {}
+
+    jay::frame frame;
+    std::atomic<std::uint64_t> payload; /**< Latest payload word, written from any thread */
+    clock::duration period;
+    clock::duration phase{};
+    clock::time_point next{}; /**< Absolute deadline of the next frame */
+  };
+
+  static std::int64_t to_ticks(clock::duration duration) noexcept { return duration / resolution; }
+
+  /**
+   * @internal
+   * @brief Give every entry the phase where the fewest frames are already due
+   *
+   * Frames due per tick are counted over the hyperperiod of all periods. Entries are
+   * placed shortest period first, as they occupy the most ticks, each at the phase with
+   * the lowest peak and then the lowest total of frames due on its ticks.
+   * @note Hyperperiods longer than max_horizon are cut, so odd periods are only spread approximately
+   */
+  void spread_phases()
+  {
+    std::int64_t horizon{ 1 };
+    for (auto &cyclic : entries_) { horizon = std::min(std::lcm(horizon, to_ticks(cyclic.period)), max_horizon); }
+
+    std::vector<entry *> order{};
+    for (auto &cyclic : entries_) { order.push_back(&cyclic); }
+    std::stable_sort(order.begin(), order.end(), [](auto *lhs, auto *rhs) { return lhs->period < rhs->period; });
+
+    std::vector<std::uint32_t> load(static_cast<std::size_t>(horizon), 0);
+    for (auto *cyclic : order) {
+      auto period = to_ticks(cyclic->period);
+      std::int64_t best_phase{ 0 };
+      std::pair<std::uint32_t, std::uint64_t> best_cost{ UINT32_MAX, UINT64_MAX };
+      for (std::int64_t phase = 0; phase < std::min(period, horizon); phase++) {
+        std::pair<std::uint32_t, std::uint64_t> cost{ 0, 0 };
+        for (auto tick = phase; tick < horizon; tick += period) {
+          cost.first = std::max(cost.first, load[static_cast<std::size_t>(tick)]);
+          cost.second += load[static_cast<std::size_t>(tick)];
+        }
+        if (cost < best_cost) {
+          best_cost = cost;
+          best_phase = phase;
+        }
+      }
+
+      for (auto tick = best_phase; tick < horizon; tick += period) { load[static_cast<std::size_t>(tick)]++; }
+      cyclic->phase = best_phase * resolution;
+    }
+  }
+
+  void on_start()
+  {
+    running_ = true;
+    auto start = clock::now();
+    for (auto &cyclic : entries_) { cyclic.next = start + cyclic.phase; }
+    batch_.reserve(entries_.size());
+    schedule();
+  }
+
+  /**
+   * @internal
+   * @brief Set the timer to the earliest deadline
+   * @note A linear scan is used as there are only tens of cyclic frames
+   */
+  void schedule()
+  {
+    if (!running_ || entries_.empty()) { return; }
+
+    auto next = clock::time_point::max();
+    for (auto &cyclic : entries_) { next = std::min(next, cyclic.next); }
+
+    timer_.expires_at(next);
+    timer_.async_wait(boost::asio::bind_executor(strand_, [this](auto error_code) {
+      if (error_code) { return on_fail("on_cyclic_tick", error_code); }
+      on_tick();
+    }));
+  }
+
+  void on_tick()
+  {
+    if (!running_) { return; }
+
+    auto now = clock::now();
+    auto address = network_.get_address(name_);
+    auto lateness = max_lateness_.load(std::memory_order_relaxed);
+
+    batch_.clear();
+    for (auto &cyclic : entries_) {
+      if (cyclic.next > now) { continue; }
+      lateness = std::max(lateness, std::chrono::nanoseconds{ now - cyclic.next }.count());
+
+      cyclic.frame.payload = jay::to_payload(cyclic.payload.load(std::memory_order_relaxed));
+      cyclic.frame.header.source_adderess(address);
+      batch_.push_back(cyclic.frame);
+
+      // Stay on the absolute grid, periods that were missed entirely are skipped rather than sent as a burst
+      cyclic.next += cyclic.period;
+      if (cyclic.next <= now) {
+        auto missed = (now - cyclic.next) / cyclic.period + 1;
+        cyclic.next += missed * cyclic.period;
+        skipped_.fetch_add(static_cast<std::uint64_t>(missed), std::memory_order_relaxed);
+      }
+    }
+    max_lateness_.store(lateness, std::memory_order_relaxed);
+
+    if (!batch_.empty()) {
+      if (address > J1939_MAX_UNICAST_ADDR) {
+        no_address_.fetch_add(1, std::memory_order_relaxed);
+      } else {
+        ticks_.fetch_add(1, std::memory_order_relaxed);
+        frames_.fetch_add(batch_.size(), std::memory_order_relaxed);
+        if (callbacks_.on_frames) { callbacks_.on_frames(batch_); }
+      }
+    }
+    schedule();
+  }
+
+  /**
+   * @brief Checks the for ignorable errors. Errors cant be ignored
+   * the error code is sent to the on_error callback
+   *
+   * @param what - function name the error happened in
+   * @param error_code - containing information regarding the error
+   */
+  void on_fail(char const *what, boost::system::error_code error_code)
+  {
+    // Don't report these
+    if (error_code == boost::asio::error::operation_aborted) { return; }
+    if (callbacks_.on_error) { callbacks_.on_error(what, error_code); }
+  }
+
+private:
+  // Internal
+  boost::asio::strand<boost::asio::io_context::executor_type> strand_;
+  boost::asio::steady_timer timer_;
+  bool started_{ false };
+  bool running_{ false };
+
+  // Injected
+  jay::name name_;
+  const jay::network &network_;
+  callbacks callbacks_{};
+
+  std::deque<entry> entries_{}; /**< Deque as entries hold atomics and can't be moved */
+  std::vector<jay::frame> batch_{}; /**< Frames due in the current tick, reused between ticks */
+
+  std::atomic<std::uint64_t> ticks_{ 0 };
+  std::atomic<std::uint64_t> frames_{ 0 };
+  std::atomic<std::uint64_t> skipped_{ 0 };
+  std::atomic<std::uint64_t> no_address_{ 0 };
+  std::atomic<std::int64_t> max_lateness_{ 0 };
+};
+
+}// namespace jay
+
+#endif
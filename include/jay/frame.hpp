@@ -14,6 +14,7 @@
 
 // C++
 #include <array>
+#include <cstring>
 #include <sstream>
 #include <string>
 
@@ -44,14 +45,14 @@ struct frame
   /**
    * Constructor
    */
-  frame() = default;
+  constexpr frame() = default;
 
   /**
    * Constructor
    * @param in_header
    * @param in_payload
    */
-  frame(const frame_header &in_header, const payload &in_payload) : header(in_header), payload(in_payload)
+  constexpr frame(const frame_header &in_header, const payload &in_payload) : header(in_header), payload(in_payload)
   {
     // Cant use this as size will allways be 8 and that will not match
     // All usecases
@@ -69,7 +70,7 @@ struct frame
    * @note sets PS to NO_ADDR thereby requesting address of all devices
    * @return address request j1939 frame
    */
-  static frame make_address_request() { return make_address_request(J1939_NO_ADDR); }
+  static constexpr frame make_address_request() { return make_address_request(J1939_NO_ADDR); }
 
   /**
    * Create an address request j1939 frame
@@ -78,10 +79,44 @@ struct frame
    * from a specific address
    * @return address request j1939 frame
    */
-  static frame make_address_request(std::uint8_t PS)
+  static constexpr frame make_address_request(std::uint8_t PS)
   {
-    return { frame_header(static_cast<std::uint8_t>(6), false, PF_REQUEST, PS, J1939_IDLE_ADDR, 3),
-      { 0x00, 0xEE, 0x00 } };
+    return make_request(J1939_PGN_ADDRESS_CLAIMED, PS, J1939_IDLE_ADDR);
+  }
+
+  /**
+   * Create a request j1939 frame
+   * @param pgn to request
+   * @param destination address to request from, J1939_NO_ADDR requests from all controllers
+   * @param source_address of the requesting controller
+   * @return request j1939 frame
+   */
+  static constexpr frame make_request(pgn_t pgn, std::uint8_t destination, std::uint8_t source_address)
+  {
+    return { frame_header(static_cast<std::uint8_t>(6), false, PF_REQUEST, destination, source_address, 3),
+      { static_cast<std::uint8_t>(pgn), static_cast<std::uint8_t>(pgn >> 8), static_cast<std::uint8_t>(pgn >> 16) } };
+  }
+
+  /**
+   * Create an acknowledgement j1939 frame, sent to global
+   * @param control byte, one of jay::ACK_POSITIVE, ACK_NEGATIVE, ACK_ACCESS_DENIED or ACK_CANNOT_RESPOND
+   * @param pgn that is acknowledged
+   * @param requester address of the controller that sent the request
+   * @param source_address of the acknowledging controller
+   * @return acknowledgement j1939 frame
+   */
+  static constexpr frame
+    make_acknowledgement(std::uint8_t control, pgn_t pgn, std::uint8_t requester, std::uint8_t source_address)
+  {
+    return { frame_header(static_cast<std::uint8_t>(6), false, PF_ACKNOWLEDGE, J1939_NO_ADDR, source_address, 8),
+      { control,
+        0xFF,
+        0xFF,
+        0xFF,
+        requester,
+        static_cast<std::uint8_t>(pgn),
+        static_cast<std::uint8_t>(pgn >> 8),
+        static_cast<std::uint8_t>(pgn >> 16) } };
   }
 
   /**
@@ -90,7 +125,7 @@ struct frame
    * @param address to claim
    * @return address claim j1939 frame
    */
-  static frame make_address_claim(jay::name name, std::uint8_t address)
+  static constexpr frame make_address_claim(jay::name name, std::uint8_t address)
   {
     /// TODO: Replace payload with name type
     return { frame_header(static_cast<std::uint8_t>(6), false, PF_ADDRESS_CLAIM, J1939_NO_ADDR, address, 8), name };
@@ -101,7 +136,7 @@ struct frame
    * @param name of the device
    * @return address cannot claim j1939 frame
    */
-  static frame make_cannot_claim(jay::name name)
+  static constexpr frame make_cannot_claim(jay::name name)
   {
     /// TODO: Replace payload with name type
     return { frame_header(static_cast<std::uint8_t>(6), false, PF_ADDRESS_CLAIM, J1939_NO_ADDR, J1939_IDLE_ADDR, 8),
@@ -0,0 +1,299 @@
+//
+// Copyright (c) 2022 Bjørn Fuglestad, Jaersense AS (bjorn@jaersense.no)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/bjorn-jaes/jay
+//
+
+#ifndef JAY_FRAME_COLUMNS_H
+#define JAY_FRAME_COLUMNS_H
+
+#pragma once
+
+// C++
+#include <cstddef>//offsetof
+#include <cstdint>//std::uint8_t, std::uint32_t, std::uint64_t
+#include <cstring>//std::memcpy
+#include <vector>//std::vector
+
+// Local
+#include "frame.hpp"// jay::frame
+#include "pgn_codec.hpp"// jay::to_word
+
+// Linux
+#include <linux/can.h>//can_frame, CAN_EFF_MASK
+
+// SIMD paths assume the payload is stored little endian, like jay::to_word returns it
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define JAY_COLUMNS_AVX2
+#elif defined(__ARM_NEON) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#include <arm_neon.h>
+#define JAY_COLUMNS_NEON
+#endif
+
+namespace jay {
+
+static_assert(sizeof(jay::frame) == sizeof(can_frame), "Frame must have the same layout as can_frame");
+
+/**
+ * @brief Structure-of-arrays view of a batch of frames
+ *
+ * Each header field is extracted into its own column so that analysis over millions of
+ * frames runs over contiguous arrays instead of calling the frame_header getters per frame.
+ * Row i of every column belongs to the same frame.
+ */
+struct frame_columns
+{
+  std::vector<std::uint32_t> id{}; /**< 29-bit identifier, flags removed */
+  std::vector<pgn_t> pgn{}; /**< @see frame_header::pgn */
+  std::vector<std::uint8_t> pdu_format{}; /**< @see frame_header::pdu_format */
+  std::vector<std::uint8_t> pdu_specific{}; /**< @see frame_header::pdu_specific */
+  std::vector<std::uint8_t> source_address{}; /**< @see frame_header::source_adderess */
+  std::vector<priority_t> priority{}; /**< @see frame_header::priority */
+  std::vector<std::uint8_t> length{}; /**< @see frame_header::payload_length */
+  std::vector<std::uint64_t> payload{}; /**< Payload as a little endian word, @see jay::to_word */
+
+#if defined(JAY_COLUMNS_AVX2)
+  static constexpr const char *simd = "avx2";
+#elif defined(JAY_COLUMNS_NEON)
+  static constexpr const char *simd = "neon";
+#else
+  static constexpr const char *simd = "scalar";
+#endif
+
+  /**
+   * @brief Get number of frames in the columns
+   * @return number of rows
+   */
+  std::size_t size() const noexcept { return id.size(); }
+
+  /**
+   * @brief Resize all columns
+   * @param size number of rows
+   */
+  void resize(std::size_t size)
+  {
+    id.resize(size);
+    pgn.resize(size);
+    pdu_format.resize(size);
+    pdu_specific.resize(size);
+    source_address.resize(size);
+    priority.resize(size);
+    length.resize(size);
+    payload.resize(size);
+  }
+};
+
+namespace detail {
+
+/**
+ * @internal
+ * @brief Extract rows [first, count) one frame at a time
+ * @param data frames, each frame is 16 bytes laid out as a can_frame
+ */
+inline void
+  extract_columns_scalar(const std::uint8_t *data, std::size_t first, std::size_t count, frame_columns &columns)
+{
+  for (std::size_t i = first; i < count; i++) {
+    const auto *record = data + i * sizeof(can_frame);
+    std::uint32_t id{};
+    std::memcpy(&id, record, sizeof(id));
+    id &= CAN_EFF_MASK;
+
+    auto pdu_format = static_cast<std::uint8_t>(id >> 16);
+    auto pgn = (id >> 8) & 0x3FFFFU;
+    if (pdu_format <= PF_PDU1_MAX) { pgn &= ~0xFFU; }
+
+    jay::payload payload{};
+    std::memcpy(payload.data(), record + offsetof(can_frame, data), payload.size());
+
+    columns.id[i] = id;
+    columns.pgn[i] = pgn;
+    columns.pdu_format[i] = pdu_format;
+    columns.pdu_specific[i] = static_cast<std::uint8_t>(id >> 8);
+    columns.source_address[i] = static_cast<std::uint8_t>(id);
+    columns.priority[i] = static_cast<priority_t>((id >> 26) & 0x7);
+    columns.length[i] = record[offsetof(can_frame, can_dlc)];
+    columns.payload[i] = jay::to_word(payload);
+  }
+}
+
+#if defined(JAY_COLUMNS_AVX2)
+
+/**
+ * @internal
+ * @brief Narrow 8 32-bit lanes, each less than 256, to bytes and store them
+ */
+inline void store_bytes(std::uint8_t *out, __m256i values) noexcept
+{
+  auto words = _mm256_packus_epi32(values, values);
+  auto bytes = _mm256_packus_epi16(words, words);
+  auto low = static_cast<std::uint32_t>(_mm_cvtsi128_si32(_mm256_castsi256_si128(bytes)));
+  auto high = static_cast<std::uint32_t>(_mm256_extract_epi32(bytes, 4));
+  std::memcpy(out, &low, sizeof(low));
+  std::memcpy(out + 4, &high, sizeof(high));
+}
+
+/**
+ * @internal
+ * @brief Extract 8 frames per iteration with AVX2
+ * @return number of rows extracted, the remainder is left for the scalar path
+ */
+inline std::size_t extract_columns_simd(const std::uint8_t *data, std::size_t count, frame_columns &columns) noexcept
+{
+  const auto eff_mask = _mm256_set1_epi32(static_cast<int>(CAN_EFF_MASK));
+  const auto byte_mask = _mm256_set1_epi32(0xFF);
+  const auto pgn_mask = _mm256_set1_epi32(0x3FFFF);
+  const auto priority_mask = _mm256_set1_epi32(0x7);
+  const auto pdu2_min = _mm256_set1_epi32(PF_PDU1_MAX + 1);
+  const auto split = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+
+  std::size_t i{ 0 };
+  for (; i + 8 <= count; i += 8) {
+    const auto *record = reinterpret_cast<const __m256i *>(data + i * sizeof(can_frame));
+    auto v0 = _mm256_loadu_si256(record);
+    auto v1 = _mm256_loadu_si256(record + 1);
+    auto v2 = _mm256_loadu_si256(record + 2);
+    auto v3 = _mm256_loadu_si256(record + 3);
+
+    // Each register holds two frames as [header, payload] words, unpacking gives
+    // words from frames [0, 2, 1, 3] which are put back in order by the permute
+    auto headers_low = _mm256_permute4x64_epi64(_mm256_unpacklo_epi64(v0, v1), 0xD8);
+    auto headers_high = _mm256_permute4x64_epi64(_mm256_unpacklo_epi64(v2, v3), 0xD8);
+    auto payload_low = _mm256_permute4x64_epi64(_mm256_unpackhi_epi64(v0, v1), 0xD8);
+    auto payload_high = _mm256_permute4x64_epi64(_mm256_unpackhi_epi64(v2, v3), 0xD8);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(columns.payload.data() + i), payload_low);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(columns.payload.data() + i + 4), payload_high);
+
+    // Header words are [id, dlc], split into a register of 8 ids and one of 8 dlc
+    auto split_low = _mm256_permutevar8x32_epi32(headers_low, split);
+    auto split_high = _mm256_permutevar8x32_epi32(headers_high, split);
+    auto id = _mm256_and_si256(_mm256_permute2x128_si256(split_low, split_high, 0x20), eff_mask);
+    auto dlc = _mm256_and_si256(_mm256_permute2x128_si256(split_low, split_high, 0x31), byte_mask);
+
+    auto pdu_specific = _mm256_and_si256(_mm256_srli_epi32(id, 8), byte_mask);
+    auto pdu_format = _mm256_and_si256(_mm256_srli_epi32(id, 16), byte_mask);
+    auto pdu1 = _mm256_cmpgt_epi32(pdu2_min, pdu_format);
+    auto pgn = _mm256_and_si256(_mm256_srli_epi32(id, 8), pgn_mask);
+    pgn = _mm256_andnot_si256(_mm256_and_si256(pdu1, byte_mask), pgn);
+
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(columns.id.data() + i), id);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(columns.pgn.data() + i), pgn);
+    store_bytes(columns.pdu_format.data() + i, pdu_format);
+    store_bytes(columns.pdu_specific.data() + i, pdu_specific);
+    store_bytes(columns.source_address.data() + i, _mm256_and_si256(id, byte_mask));
+    store_bytes(columns.priority.data() + i, _mm256_and_si256(_mm256_srli_epi32(id, 26), priority_mask));
+    store_bytes(columns.length.data() + i, dlc);
+  }
+  return i;
+}
+
+#elif defined(JAY_COLUMNS_NEON)
+
+/**
+ * @internal
+ * @brief Narrow 4 32-bit lanes, each less than 256, to bytes and store them
+ */
+inline void store_bytes(std::uint8_t *out, uint32x4_t values) noexcept
+{
+  auto words = vmovn_u32(values);
+  auto bytes = vmovn_u16(vcombine_u16(words, words));
+  vst1_lane_u32(reinterpret_cast<std::uint32_t *>(out), vreinterpret_u32_u8(bytes), 0);
+}
+
+/**
+ * @internal
+ * @brief Extract 4 frames per iteration with NEON
+ * @return number of rows extracted, the remainder is left for the scalar path
+ */
+inline std::size_t extract_columns_simd(const std::uint8_t *data, std::size_t count, frame_columns &columns) noexcept
+{
+  const auto byte_mask = vdupq_n_u32(0xFF);
+  const auto pdu1_max = vdupq_n_u32(PF_PDU1_MAX);
+
+  std::size_t i{ 0 };
+  for (; i + 4 <= count; i += 4) {
+    // De-interleaving load, val[0] is the ids, val[1] the dlc words and val[2], val[3] the payload halves
+    auto frames = vld4q_u32(reinterpret_cast<const std::uint32_t *>(data + i * sizeof(can_frame)));
+    auto *payload = reinterpret_cast<std::uint32_t *>(columns.payload.data() + i);
+    vst2q_u32(payload, uint32x4x2_t{ { frames.val[2], frames.val[3] } });
+
+    auto id = vandq_u32(frames.val[0], vdupq_n_u32(CAN_EFF_MASK));
+    auto pdu_specific = vandq_u32(vshrq_n_u32(id, 8), byte_mask);
+    auto pdu_format = vandq_u32(vshrq_n_u32(id, 16), byte_mask);
+    auto pdu1 = vcleq_u32(pdu_format, pdu1_max);
+    auto pgn = vbicq_u32(vandq_u32(vshrq_n_u32(id, 8), vdupq_n_u32(0x3FFFF)), vandq_u32(pdu1, byte_mask));
+
+    vst1q_u32(columns.id.data() + i, id);
+    vst1q_u32(columns.pgn.data() + i, pgn);
+    store_bytes(columns.pdu_format.data() + i, pdu_format);
+    store_bytes(columns.pdu_specific.data() + i, pdu_specific);
+    store_bytes(columns.source_address.data() + i, vandq_u32(id, byte_mask));
+    store_bytes(columns.priority.data() + i, vandq_u32(vshrq_n_u32(id, 26), vdupq_n_u32(0x7)));
+    store_bytes(columns.length.data() + i, vandq_u32(frames.val[1], byte_mask));
+  }
+  return i;
+}
+
+#endif
+
+}// namespace detail
+
+/**
+ * @brief Extract the header fields and payload of a batch of frames into columns,
+ * one frame at a time
+ * @note Reference for decode_columns, which should be used instead
+ * @param frames to extract
+ * @param count number of frames
+ * @param columns resized to count and overwritten
+ */
+inline void decode_columns_scalar(const jay::frame *frames, std::size_t count, frame_columns &columns)
+{
+  columns.resize(count);
+  detail::extract_columns_scalar(reinterpret_cast<const std::uint8_t *>(frames), 0, count, columns);
+}
+
+/**
+ * @copydoc decode_columns_scalar(const jay::frame *, std::size_t, frame_columns &)
+ */
+inline void decode_columns_scalar(const can_frame *frames, std::size_t count, frame_columns &columns)
+{
+  columns.resize(count);
+  detail::extract_columns_scalar(reinterpret_cast<const std::uint8_t *>(frames), 0, count, columns);
+}
+
+/**
+ * @brief Extract the header fields and payload of a batch of frames into columns
+ *
+ * Uses AVX2 (8 frames per iteration) or NEON (4 frames per iteration) shifts and masks
+ * when the target supports it, see frame_columns::simd. Remaining frames are extracted
+ * one at a time.
+ * @param frames to extract
+ * @param count number of frames
+ * @param columns resized to count and overwritten
+ */
+inline void decode_columns(const jay::frame *frames, std::size_t count, frame_columns &columns)
+{
+  columns.resize(count);
+  const auto *data = reinterpret_cast<const std::uint8_t *>(frames);
+#if defined(JAY_COLUMNS_AVX2) || defined(JAY_COLUMNS_NEON)
+  detail::extract_columns_scalar(data, detail::extract_columns_simd(data, count, columns), count, columns);
+#else
+  detail::extract_columns_scalar(data, 0, count, columns);
+#endif
+}
+
+/**
+ * @copydoc decode_columns(const jay::frame *, std::size_t, frame_columns &)
+ */
+inline void decode_columns(const can_frame *frames, std::size_t count, frame_columns &columns)
+{
+  decode_columns(reinterpret_cast<const jay::frame *>(frames), count, columns);
+}
+
+}// namespace jay
+
+#endif
@@ -15,12 +15,12 @@
 // C++
 #include <algorithm>//std::clamp
 
-// Libraries
-#include "canary/frame_header.hpp"
-
 // Local
 #include "j1939.hpp"//std::uint8_t ... , pgn_t and priority_t
 
+// Linux
+#include <linux/can.h>//CAN_EFF_FLAG, CAN_EFF_MASK
+
 namespace jay {
 
 
@@ -28,7 +28,8 @@ namespace jay {
  * @mainpage
  * @brief Class that for manipulating a J1939 frame header data
  *
- * Class is a wrapper around canary frame_header class
+ * Class has the same layout as the header of a linux can_frame, so that frames can be
+ * read and written directly, and is fully constexpr so fixed headers can be compile-time constants
  * Remember order is [31] ... [0] this is not an array where 0 is the first index
  * First three bits are EFF/RTR/ERR flags then followed by 29-bit message
  * Frame format flag (EFF)          = [31] 1-bit, 0 = stardard 11-bit, 1 = extended 29-bit, always 1 in j1939
@@ -62,17 +63,10 @@ public:
 
   /**
    * @brief Default construction of empty j1939 frame header
-   * @note all other constructors call this to ensure that
-   * the correct flags are set
+   * @note the extended format flag is set by the member initializers,
+   * error and remote transmission flags are allways cleared
    */
-  frame_header() : header_()
-  {
-    // Allways the case with j1939 headers
-    // Make sure that any other constructors invoke this constructor
-    header_.extended_format(true);
-    header_.error(false);
-    header_.remote_transmission(false);
-  }
+  constexpr frame_header() = default;
 
   /**
    * @brief Construct a j1939 frame header using all value fields
@@ -83,7 +77,7 @@ public:
    * @param pdu_specific (PS) @see pdu_specific for more info
    * @param source_address of the frame
    */
-  frame_header(const priority_t priority,
+  constexpr frame_header(const priority_t priority,
     const bool data_page,
     const std::uint8_t pdu_format,
     const std::uint8_t pdu_specific,
@@ -105,7 +99,7 @@ public:
    * reserved bit - data page bit - PF - PS
    * @param source_address of the frame
    */
-  frame_header(const priority_t priority,
+  constexpr frame_header(const priority_t priority,
     const pgn_t pgn,
     const std::uint8_t source_address,
     const std::size_t payload = 0)
@@ -117,11 +111,9 @@ public:
    * @brief Construct a j1939 frame header from complete header data
    * @param header_data containing the 29 bits that j1939 structures use
    */
-  frame_header(const std::uint32_t header_data, const std::uint8_t payload = 0) : frame_header()
-  {
-    header_.id(header_data);
-    header_.payload_length(payload);
-  }
+  constexpr frame_header(const std::uint32_t header_data, const std::uint8_t payload = 0)
+    : id_(CAN_EFF_FLAG | (header_data & CAN_EFF_MASK)), length_(payload)
+  {}
 
 
   //@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@//
@@ -132,9 +124,9 @@ public:
    * @brief  Sets the J1939 ID of this frame. J1939 IDs are 29-bit integers
    * @param id of the header
    */
-  frame_header &id(const std::uint32_t id)
+  constexpr frame_header &id(const std::uint32_t id)
   {
-    header_.id(id);
+    id_ = CAN_EFF_FLAG | (id & CAN_EFF_MASK);
     return *this;
   }
 
@@ -143,7 +135,7 @@ public:
    * @param priority, ranging from 0 highest and 7 lowest
    * @note function will clamp priority to a value between 0 - 7
    */
-  frame_header &priority(const priority_t priority)
+  constexpr frame_header &priority(const priority_t priority)
   {
     id((id() & ~prio_mask) | (std::clamp(static_cast<std::uint32_t>(priority), 0U, 7U) << 26));
     return *this;
@@ -154,7 +146,7 @@ public:
    * PDU address by adding another bit of possible addresses
    * @param data_page_bit between 0 and 1, is clamped if needed.
    */
-  frame_header &data_page(const bool data_page_bit)
+  constexpr frame_header &data_page(const bool data_page_bit)
   {
     // data_page_bit_ = (data_page_bit) ? 1 : 0;
     id((id() & ~data_page_mask) | (static_cast<std::uint32_t>(data_page_bit ? 1 : 0) << 24));
@@ -172,7 +164,7 @@ public:
    * 0xF0 – 0xFE: Broadcast messages defined by SAE
    * 0xFF – 0xFF: Broadcast messages for proprietary use
    */
-  frame_header &pdu_format(const std::uint8_t pdu_format)
+  constexpr frame_header &pdu_format(const std::uint8_t pdu_format)
   {
     id((id() & ~pf_mask) | (static_cast<std::uint32_t>(pdu_format) << 16));
     return *this;
@@ -183,7 +175,7 @@ public:
    * @param pdu_specific (PS) is either the destination address if the PDU format (PF) is
    * a peer-to-peer massage or a PSU group extention if the PF is a broadcast message.
    */
-  frame_header &pdu_specific(const std::uint8_t pdu_specific)
+  constexpr frame_header &pdu_specific(const std::uint8_t pdu_specific)
   {
     id((id() & ~ps_mask) | (static_cast<std::uint32_t>(pdu_specific) << 8));
     return *this;
@@ -193,7 +185,7 @@ public:
    * @brief Set the source address of the can frame.
    * @param source_address of the frame
    */
-  frame_header &source_adderess(const std::uint8_t source_address)
+  constexpr frame_header &source_adderess(const std::uint8_t source_address)
   {
     id((id() & ~ad_mask) | static_cast<std::uint32_t>(source_address));
     return *this;
@@ -203,9 +195,9 @@ public:
    * @brief Set length of the data that is assiociated with the header
    * @param source_address of the frame
    */
-  frame_header &payload_length(const std::size_t length)
+  constexpr frame_header &payload_length(const std::size_t length)
   {
-    header_.payload_length(length);
+    length_ = static_cast<std::uint8_t>(length);
     return *this;
   }
 
@@ -217,19 +209,22 @@ public:
    * @brief Get the header id
    * @return 29 bit header id
    */
-  std::uint32_t id() const noexcept { return header_.id(); }
+  constexpr std::uint32_t id() const noexcept { return id_ & CAN_EFF_MASK; }
 
   /**
    * @brief Get the priority of the j1939 frame
    * @return priority of frame, 0 highest and 7 lowest
    */
-  priority_t priority() const noexcept { return static_cast<priority_t>((header_.id() & prio_mask) >> 26); }
+  constexpr priority_t priority() const noexcept { return static_cast<priority_t>((id() & prio_mask) >> 26); }
 
   /**
    * @brief Get the data page bit
    * @return data page bit, 0 if not set, 1 if set
    */
-  std::uint8_t data_page() const noexcept { return static_cast<std::uint8_t>((header_.id() & data_page_mask) >> 24); }
+  constexpr std::uint8_t data_page() const noexcept
+  {
+    return static_cast<std::uint8_t>((id() & data_page_mask) >> 24);
+  }
 
   /**
    * @brief Get the 18-bit parameter group number (PGN) of the header
@@ -238,9 +233,9 @@ public:
    * @note if the pdu format is global then pdu specific is returned with pgn if not then
    * pdu specific bytes are set to 0x00.
    */
-  pgn_t pgn() const noexcept
+  constexpr pgn_t pgn() const noexcept
   {
-    auto pgn = (header_.id() & pgn_mask);
+    auto pgn = (id() & pgn_mask);
     if (!is_broadcast()) { pgn &= ~ps_mask; }
     return pgn >> 8;
   }
@@ -249,9 +244,9 @@ public:
    * @brief Get the PDU Format data of the J1939 frame.
    * @return 8bit PDU Format
    */
-  std::uint8_t pdu_format() const noexcept
+  constexpr std::uint8_t pdu_format() const noexcept
   {
-    return static_cast<std::uint8_t>(header_.id() >> 16);// Return bits 23 - 16, third byte
+    return static_cast<std::uint8_t>(id() >> 16);// Return bits 23 - 16, third byte
   }
 
   /**
@@ -260,25 +255,25 @@ public:
    * the destination address of the frame
    * @return 8bit PDU Specifier
    */
-  std::uint8_t pdu_specific() const noexcept
+  constexpr std::uint8_t pdu_specific() const noexcept
   {
-    return static_cast<std::uint8_t>(header_.id() >> 8);// Return bits 15 - 8, second byte
+    return static_cast<std::uint8_t>(id() >> 8);// Return bits 15 - 8, second byte
   }
 
   /**
    * @brief Get the source address of the frame
    * @return 8 bit soruce address
    */
-  std::uint8_t source_adderess() const noexcept
+  constexpr std::uint8_t source_adderess() const noexcept
   {
-    return static_cast<std::uint8_t>(header_.id());// Return bits 7 - 0, first byte
+    return static_cast<std::uint8_t>(id());// Return bits 7 - 0, first byte
   }
 
   /**
    * @brief Get length of the data that is assiociated with the header
    * @param source_address of the frame
    */
-  std::size_t payload_length() const noexcept { return header_.payload_length(); }
+  constexpr std::size_t payload_length() const noexcept { return length_; }
 
   /// TODO: Add a tuple return for getting each component?
 
@@ -292,21 +287,31 @@ public:
    * @return true if broadcast,
    * @return false if peer-to-peer
    */
-  bool is_broadcast() const noexcept { return pdu_format() > PF_PDU1_MAX; }
+  constexpr bool is_broadcast() const noexcept { return pdu_format() > PF_PDU1_MAX; }
 
   /**
    * @brief Check if the header contains an address request
    * @return true if the header is an address request
    * @return false if the header is not an address request
    */
-  bool is_request() const noexcept { return (pgn() & J1939_PGN_PDU1_MAX) == J1939_PGN_REQUEST; }
+  constexpr bool is_request() const noexcept { return (pgn() & J1939_PGN_PDU1_MAX) == J1939_PGN_REQUEST; }
 
   /**
    * @brief Check if the header contains an address claim
    * @return true true if the header is an address claim
    * @return false false if the header is not an address claim
    */
-  bool is_claim() const noexcept { return (pgn() & J1939_PGN_PDU1_MAX) == J1939_PGN_ADDRESS_CLAIMED; }
+  constexpr bool is_claim() const noexcept { return (pgn() & J1939_PGN_PDU1_MAX) == J1939_PGN_ADDRESS_CLAIMED; }
+
+  /**
+   * @brief Check if the header contains an acknowledgement
+   * @return true if the header is an acknowledgement
+   * @return false if the header is not an acknowledgement
+   */
+  constexpr bool is_acknowledgement() const noexcept
+  {
+    return (pgn() & J1939_PGN_PDU1_MAX) == static_cast<pgn_t>(PF_ACKNOWLEDGE) << 8;
+  }
 
 private:
   static constexpr std::uint32_t prio_mask = 0x1C'00'00'00U;
@@ -316,7 +321,12 @@ private:
   static constexpr std::uint32_t ps_mask = 0x00'00'FF'00U;
   static constexpr std::uint32_t ad_mask = 0x00'00'00'FFU;
 
-  canary::frame_header header_{};
+  // Same layout as the start of a linux can_frame, extended format flag is allways set in j1939
+  std::uint32_t id_{ CAN_EFF_FLAG };
+  std::uint8_t length_{ 0 };
+  std::uint8_t pad_{ 0 };
+  std::uint8_t res0_{ 0 };
+  std::uint8_t res1_{ 0 };
 };
 
 static_assert(sizeof(jay::frame_header) == sizeof(std::uint64_t), "Size of frame header must be exactly 8 bytes");
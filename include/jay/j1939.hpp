@@ -30,6 +30,15 @@ constexpr std::uint8_t PF_ADDRESS_CLAIM{ 0xEEU };
 constexpr std::uint8_t PF_REQUEST{ 0xEAU };
 constexpr std::uint8_t PF_ACKNOWLEDGE{ 0xE8U };
 
+/**
+ * Control byte (first byte) of an acknowledgement, the PGN that is acknowledged
+ * is in the last three bytes and the address of the requester in the fifth
+ */
+constexpr std::uint8_t ACK_POSITIVE{ 0x00U };
+constexpr std::uint8_t ACK_NEGATIVE{ 0x01U };
+constexpr std::uint8_t ACK_ACCESS_DENIED{ 0x02U };
+constexpr std::uint8_t ACK_CANNOT_RESPOND{ 0x03U };
+
 }// namespace jay
 
 /// TODO: Which should be default on?
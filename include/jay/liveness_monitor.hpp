@@ -0,0 +1,204 @@
+//
+// Copyright (c) 2022 Bjørn Fuglestad, Jaersense AS (bjorn@jaersense.no)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/bjorn-jaes/jay
+//
+
+#ifndef JAY_LIVENESS_MONITOR_H
+#define JAY_LIVENESS_MONITOR_H
+
+#pragma once
+
+// C++
+#include <algorithm>//std::find
+#include <atomic>//std::atomic
+#include <chrono>//std::chrono::steady_clock
+#include <functional>//std::function
+#include <string>//std::string
+#include <vector>//std::vector
+
+// Lib
+#include "boost/asio/bind_executor.hpp"//boost::asio::bind_executor
+#include "boost/asio/io_context.hpp"//boost::asio::io_context
+#include "boost/asio/post.hpp"//boost::asio::post
+#include "boost/asio/steady_timer.hpp"//boost::asio::steady_timer
+#include "boost/asio/strand.hpp"//boost::asio::strand
+
+// Local
+#include "frame.hpp"
+#include "network.hpp"
+
+namespace jay {
+
+/**
+ * @brief Releases the addresses of controllers that have gone silent
+ *
+ * Frames read from the bus are recorded in the lock free activity table of the network,
+ * either by passing them to process or by calling network::seen directly from the
+ * receive path. A timer sweeps the table and releases controllers that have not sent a
+ * frame for the silence period, so stale entries do not stay in the network forever.
+ * Local controllers are not read back from the bus, so they must be protected unless
+ * their transmissions are recorded with network::seen.
+ * @note Events are handled on a strand of the context, callbacks are called from it
+ */
+class liveness_monitor
+{
+public:
+  using clock = jay::network::clock;
+
+  /**
+   * @brief Callbacks used by the liveness monitor
+   */
+  struct callbacks
+  {
+    // Called when a controller has been silent and its address is released
+    std::function<void(jay::name, std::uint8_t)> on_lost;
+    // Called when an internal error occurs, used for debugging
+    std::function<void(std::string, const boost::system::error_code &)> on_error;
+  };
+
+  /**
+   * @brief Constructor
+   * @param context from boost asio
+   * @param network containing name address pairs
+   * @param silence time without frames before a controller is lost, 3 s covers the
+   * slowest common broadcast rates with a missed frame
+   * @note remember to add callbacks for getting data out of object
+   */
+  liveness_monitor(boost::asio::io_context &context,
+    jay::network &network,
+    clock::duration silence = std::chrono::seconds(3))
+    : strand_(boost::asio::make_strand(context)), timer_(strand_), network_(network), silence_(silence)
+  {}
+
+  /**
+   * @brief Constructor with callbacks
+   * @param context from boost asio
+   * @param network containing name address pairs
+   * @param callbacks for getting data out of object
+   * @param silence time without frames before a controller is lost
+   */
+  liveness_monitor(boost::asio::io_context &context,
+    jay::network &network,
+    callbacks &&callbacks,
+    clock::duration silence = std::chrono::seconds(3))
+    : strand_(boost::asio::make_strand(context)), timer_(strand_), network_(network), silence_(silence),
+      callbacks_(std::move(callbacks))
+  {}
+
+  /**
+   * @brief set the callbacks for the liveness monitor
+   * @param callbacks for getting data out of the object
+   */
+  void set_callbacks(callbacks &&callbacks) { callbacks_ = std::move(callbacks); }
+
+  /**
+   * @brief Record a frame read from the bus
+   * @param frame read from the bus
+   * @note is lock free, is not posted to the context
+   */
+  void process(const jay::frame &frame) const noexcept { network_.seen(frame.header.source_adderess()); }
+
+  /**
+   * @brief Never release the address of a local controller
+   * @param name of the local controller
+   * @note event is posted to context
+   */
+  void protect(jay::name name)
+  {
+    boost::asio::post(strand_, [this, name]() -> void {
+      if (std::find(local_names_.begin(), local_names_.end(), name) == local_names_.end()) {
+        local_names_.push_back(name);
+      }
+    });
+  }
+
+  /**
+   * @brief Start sweeping, a quarter of the silence period apart
+   * @note event is posted to context
+   */
+  void start()
+  {
+    boost::asio::post(strand_, [this]() -> void {
+      running_ = true;
+      schedule();
+    });
+  }
+
+  /**
+   * @brief Stop sweeping
+   * @note event is posted to context
+   */
+  void stop()
+  {
+    boost::asio::post(strand_, [this]() -> void {
+      running_ = false;
+      timer_.cancel();
+    });
+  }
+
+  /**
+   * @brief Get the number of controllers lost
+   * @return lost count
+   * @note is safe to call from any thread
+   */
+  std::uint64_t lost_count() const noexcept { return lost_.load(std::memory_order_relaxed); }
+
+private:
+  void schedule()
+  {
+    timer_.expires_after(silence_ / 4);
+    timer_.async_wait(boost::asio::bind_executor(strand_, [this](auto error_code) {
+      if (error_code) { return on_fail("on_liveness_sweep", error_code); }
+      on_sweep();
+    }));
+  }
+
+  void on_sweep()
+  {
+    if (!running_) { return; }
+    network_.release_silent(
+      silence_,
+      [this](jay::name name, std::uint8_t address) {
+        lost_.fetch_add(1, std::memory_order_relaxed);
+        if (callbacks_.on_lost) { callbacks_.on_lost(name, address); }
+      },
+      local_names_);
+    schedule();
+  }
+
+  /**
+   * @brief Checks the for ignorable errors. Errors cant be ignored
+   * the error code is sent to the on_error callback
+   *
+   * @param what - function name the error happened in
+   * @param error_code - containing information regarding the error
+   */
+  void on_fail(char const *what, boost::system::error_code error_code)
+  {
+    // Don't report these
+    if (error_code == boost::asio::error::operation_aborted) { return; }
+    if (callbacks_.on_error) { callbacks_.on_error(what, error_code); }
+  }
+
+private:
+  // Internal
+  boost::asio::strand<boost::asio::io_context::executor_type> strand_;
+  boost::asio::steady_timer timer_;
+  bool running_{ false };
+  std::vector<jay::name> local_names_{};
+
+  // Injected
+  jay::network &network_;
+  clock::duration silence_;
+  callbacks callbacks_{};
+
+  std::atomic<std::uint64_t> lost_{ 0 };
+};
+
+}// namespace jay
+
+#endif
@@ -55,7 +55,7 @@ public:
   /**
    * @brief Default consturctor, creates an empty ecu name
    */
-  name() = default;
+  constexpr name() = default;
 
   /**
    * @brief Constuct name from it all its elements
@@ -69,7 +69,7 @@ public:
    * @param ind_grp, industry group 3 bit
    * @param slf_cfg_addr, self configuring address, 1 bit
    */
-  name(std::uint32_t id_num,
+  constexpr name(std::uint32_t id_num,
     std::uint16_t man_code,
     std::uint8_t ecu_inst,
     std::uint8_t func_inst,
@@ -104,13 +104,13 @@ public:
    * Constuct name from existing name
    * @param name to construct from
    */
-  name(const name_t name) : name_(name) {}
+  constexpr name(const name_t name) : name_(name) {}
 
   /**
    * Construct name from j1939 frame payload
    * @param payload containing name
    */
-  name(const std::array<uint8_t, 8> &payload) : name_()
+  constexpr name(const std::array<uint8_t, 8> &payload) : name_()
   {
     name_ |= static_cast<name_t>(payload[0]);
     name_ |= static_cast<name_t>(payload[1]) << 8;
@@ -131,7 +131,7 @@ public:
    * @param id_num - 21 bit Identity Number
    * @return reference to self
    */
-  name &identity_number(const std::uint32_t id_num) noexcept
+  constexpr name &identity_number(const std::uint32_t id_num) noexcept
   {
     //             Combine
     // Clear existing | ((place bits correctly) & remove extra bits)
@@ -144,7 +144,7 @@ public:
    * @param man_code - 11 bit Manufacturer Code
    * @return reference to self
    */
-  name &manufacturer_code(std::uint16_t man_code)
+  constexpr name &manufacturer_code(std::uint16_t man_code)
   {
     name_ = (name_ & ~man_code_mask) | ((static_cast<name_t>(man_code) << man_code_start_bit) & man_code_mask);
     return *this;
@@ -155,7 +155,7 @@ public:
    * @param ecu_inst - 3 bit ECU instance
    * @return reference to self
    */
-  name &ecu_instance(std::uint8_t ecu_inst) noexcept
+  constexpr name &ecu_instance(std::uint8_t ecu_inst) noexcept
   {
     name_ = (name_ & ~ecu_inst_mask) | ((static_cast<name_t>(ecu_inst) << ecu_inst_start_bit) & ecu_inst_mask);
     return *this;
@@ -166,7 +166,7 @@ public:
    * @param func_inst - 5 bit Function instance
    * @return reference to self
    */
-  name &function_instance(std::uint8_t func_inst) noexcept
+  constexpr name &function_instance(std::uint8_t func_inst) noexcept
   {
     name_ = (name_ & ~func_inst_mask) | ((static_cast<name_t>(func_inst) << func_inst_start_bit) & func_inst_mask);
     return *this;
@@ -177,7 +177,7 @@ public:
    * @param func - 8 bit Function
    * @return reference to self
    */
-  name &function(std::uint8_t func) noexcept
+  constexpr name &function(std::uint8_t func) noexcept
   {
     name_ = (name_ & ~func_mask) | ((static_cast<name_t>(func) << func_start_bit) & func_mask);
     return *this;
@@ -188,7 +188,7 @@ public:
    * @param dev_cls - 7 bit Device class
    * @return reference to self
    */
-  name &device_class(std::uint8_t dev_cls) noexcept
+  constexpr name &device_class(std::uint8_t dev_cls) noexcept
   {
     name_ = (name_ & ~dev_cls_mask) | ((static_cast<name_t>(dev_cls) << dev_cls_start_bit) & dev_cls_mask);
     return *this;
@@ -199,7 +199,7 @@ public:
    * @param dev_cls_inst - 4 bit Device class instace
    * @return reference to self
    */
-  name &device_class_instace(std::uint8_t dev_cls_inst) noexcept
+  constexpr name &device_class_instace(std::uint8_t dev_cls_inst) noexcept
   {
     name_ = (name_ & ~dev_cls_inst_mask)
             | ((static_cast<name_t>(dev_cls_inst) << dev_cls_inst_start_bit) & dev_cls_inst_mask);
@@ -211,7 +211,7 @@ public:
    * @param ind_grp - 3 bit Industry group
    * @return reference to self
    */
-  name &industry_group(std::uint8_t ind_grp) noexcept
+  constexpr name &industry_group(std::uint8_t ind_grp) noexcept
   {
     name_ = (name_ & ~ind_grp_mask) | ((static_cast<name_t>(ind_grp) << ind_grp_start_bit) & ind_grp_mask);
     return *this;
@@ -222,7 +222,7 @@ public:
    * @param slf_cfg_addr - 1 bit Manufacturer Self config. address
    * @return reference to self
    */
-  name &self_config_address(std::uint8_t slf_cfg_addr) noexcept
+  constexpr name &self_config_address(std::uint8_t slf_cfg_addr) noexcept
   {
     name_ = (name_ & ~slf_cfg_addr_mask)
             | ((static_cast<name_t>(slf_cfg_addr) << slf_cfg_addr_start_bit) & slf_cfg_addr_mask);
@@ -237,13 +237,13 @@ public:
    * Get the Identity Number of the j1939 device name
    * @return Identity Number, 21-bits
    */
-  std::uint32_t identity_number() const noexcept { return static_cast<std::uint32_t>(name_ & id_num_mask); }
+  constexpr std::uint32_t identity_number() const noexcept { return static_cast<std::uint32_t>(name_ & id_num_mask); }
 
   /**
    * Get the Manufacturer Code of the j1939 device name
    * @return Manufacturer Code, 11-bits
    */
-  std::uint16_t manufacturer_code() const noexcept
+  constexpr std::uint16_t manufacturer_code() const noexcept
   {
     return static_cast<std::uint16_t>((name_ & man_code_mask) >> man_code_start_bit);
   }
@@ -252,7 +252,7 @@ public:
    * Get the ECU instance of the j1939 device name
    * @return ECU instance, 3-bits
    */
-  std::uint8_t ecu_instance() const noexcept
+  constexpr std::uint8_t ecu_instance() const noexcept
   {
     return static_cast<std::uint8_t>((name_ & ecu_inst_mask) >> ecu_inst_start_bit);
   }
@@ -261,7 +261,7 @@ public:
    * Get the Function instance of the j1939 device name
    * @return Function instance, 5-bits
    */
-  std::uint8_t function_instance() const noexcept
+  constexpr std::uint8_t function_instance() const noexcept
   {
     return static_cast<std::uint8_t>((name_ & func_inst_mask) >> func_inst_start_bit);
   }
@@ -270,13 +270,16 @@ public:
    * Get the Function of the j1939 device name
    * @return Function, 8-bits
    */
-  std::uint8_t function() const noexcept { return static_cast<std::uint8_t>((name_ & func_mask) >> func_start_bit); }
+  constexpr std::uint8_t function() const noexcept
+  {
+    return static_cast<std::uint8_t>((name_ & func_mask) >> func_start_bit);
+  }
 
   /**
    * Get the Device class of the j1939 device name
    * @return Device class, 7-bits
    */
-  std::uint8_t device_class() const noexcept
+  constexpr std::uint8_t device_class() const noexcept
   {
     return static_cast<std::uint8_t>((name_ & dev_cls_mask) >> dev_cls_start_bit);
   }
@@ -285,7 +288,7 @@ public:
    * Get the Device class instace of the j1939 device name
    * @return Device class instace, 4-bits
    */
-  std::uint8_t device_class_instace() const noexcept
+  constexpr std::uint8_t device_class_instace() const noexcept
   {
     return static_cast<std::uint8_t>((name_ & dev_cls_inst_mask) >> dev_cls_inst_start_bit);
   }
@@ -294,7 +297,7 @@ public:
    * Get the Industry group  of the j1939 device name
    * @return Industry group , 3-bits
    */
-  std::uint8_t industry_group() const noexcept
+  constexpr std::uint8_t industry_group() const noexcept
   {
     return static_cast<std::uint8_t>((name_ & ind_grp_mask) >> ind_grp_start_bit);
   }
@@ -303,7 +306,7 @@ public:
    * Get the Self config. address of the j1939 device name
    * @return Self config. address, 1-bit
    */
-  std::uint8_t self_config_address() const noexcept
+  constexpr std::uint8_t self_config_address() const noexcept
   {
     return static_cast<std::uint8_t>((name_ & slf_cfg_addr_mask) >> slf_cfg_addr_start_bit);
   }
@@ -312,17 +315,17 @@ public:
   //@                            Overloads                           @//
   //@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@//
 
-  bool operator<(const name &rhs) const noexcept { return (name_ < rhs.name_); }
+  constexpr bool operator<(const name &rhs) const noexcept { return (name_ < rhs.name_); }
 
-  bool operator>(const name &rhs) const noexcept { return (name_ > rhs.name_); }
+  constexpr bool operator>(const name &rhs) const noexcept { return (name_ > rhs.name_); }
 
-  bool operator==(const name &rhs) const noexcept { return (name_ == rhs.name_); }
+  constexpr bool operator==(const name &rhs) const noexcept { return (name_ == rhs.name_); }
 
-  bool operator<(const name_t rhs) const noexcept { return (name_ < rhs); }
+  constexpr bool operator<(const name_t rhs) const noexcept { return (name_ < rhs); }
 
-  bool operator>(const name_t rhs) const noexcept { return (name_ > rhs); }
+  constexpr bool operator>(const name_t rhs) const noexcept { return (name_ > rhs); }
 
-  bool operator==(const name_t rhs) const noexcept { return (name_ == rhs); }
+  constexpr bool operator==(const name_t rhs) const noexcept { return (name_ == rhs); }
 
   //@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@//
   //@                        Hash Function                           @//
@@ -344,12 +347,12 @@ public:
   /**
    *  @brief Convert name to int value
    */
-  operator name_t() const noexcept { return name_; }
+  constexpr operator name_t() const noexcept { return name_; }
 
   /**
    * @brief Convert name to array
    */
-  operator std::array<std::uint8_t, 8>() const noexcept
+  constexpr operator std::array<std::uint8_t, 8>() const noexcept
   {
     return std::array<std::uint8_t, 8>{
       static_cast<std::uint8_t>(name_),// #0
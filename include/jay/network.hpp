@@ -13,16 +13,24 @@
 #pragma once
 
 // C++
-#include <algorithm>//std::clamp
+#include <algorithm>//std::clamp, std::find
+#include <array>//std::array
+#include <atomic>//std::atomic
+#include <chrono>//std::chrono::steady_clock
+#include <list>//std::list
 #include <mutex>//std::scoped_lock
 #include <optional>//std::optional
 #include <set>//std::set
 #include <shared_mutex>//std::shared_mutex, std::shared_lock
 #include <string>//std::string
 #include <unordered_map>//std::unordered_map
+#include <unordered_set>//std::unordered_set
+#include <utility>//std::pair
+#include <vector>//std::vector
 
 // Local
 #include "name.hpp"// name, jay globals, and std::uint8_t
+#include "probes.hpp"// JAY_PROBE
 
 namespace jay {
 
@@ -30,18 +38,56 @@ namespace jay {
  * @mainpage
  * @brief Storage class for maintaining the relation between
  * controller name and its address.
+ *
+ * Names without an address are kept in least recently idle order and bounded by the
+ * idle capacity, so the network does not grow on busses where controllers come and go.
  * @note Is thread safe, needs to be passed by reference or pointer
  * as moving or copying is not allowed.
  */
 class network
 {
 public:
+  using clock = std::chrono::steady_clock;
+
+  /**
+   * @brief Fields of the name that are indexed for find_names
+   */
+  enum class name_field : std::uint8_t
+  {
+    function,
+    function_instance,
+    device_class,
+    manufacturer_code,
+    industry_group
+  };
+
+  /// Names without an address kept by default, names with an address are never evicted
+  static constexpr std::size_t default_idle_capacity{ 1024 };
+
+  /**
+   * @brief Snapshot of memory use
+   */
+  struct memory_stats
+  {
+    std::size_t names{}; /**< Names in the network */
+    std::size_t addresses{}; /**< Names with an address */
+    std::size_t idle_names{}; /**< Names without an address */
+    std::size_t idle_capacity{}; /**< Most names without an address that are kept */
+    std::uint64_t evicted{}; /**< Names removed as the idle capacity was reached */
+    std::uint64_t expired{}; /**< Names removed by expire_idle */
+    std::size_t bytes{}; /**< Estimate of heap memory used by the maps */
+  };
+
   /**
    * @brief Construct a new network object
    *
    * @param interface_name that the network is assosiated with
+   * @param idle_capacity most names without an address that are kept, the least
+   * recently idle name is removed when it is exceeded
    */
-  network(std::string interface_name) : interface_name_(interface_name) {}
+  network(std::string interface_name, std::size_t idle_capacity = default_idle_capacity)
+    : interface_name_(interface_name), idle_capacity_(idle_capacity)
+  {}
 
   /// TODO: Should be able to implement a copy, but deleted in the meantime
   network(const network &) = delete;
@@ -56,15 +102,72 @@ public:
   /**
    * @brief Get a set containing all names
    * @return set of names
+   * @note allocates a node per name, use for_each or export_entries for frequent use
    */
-  std::set<jay::name> get_name_set()
+  std::set<jay::name> get_name_set() const
   {
-    std::shared_lock lock{ network_mtx_ };
-    std::set<jay::name> set{ name_addr_map_.size() };
-    for (auto &pair : name_addr_map_) { set.insert(pair.first); }
+    std::set<jay::name> set{};
+    for_each([&set](jay::name name, std::uint8_t) { set.insert(name); });
     return set;
   }
 
+  /**
+   * @brief Name and address pair
+   */
+  struct entry
+  {
+    jay::name name{};
+    std::uint8_t address{ J1939_IDLE_ADDR }; /**< J1939_IDLE_ADDR if the name has no address */
+  };
+
+  /**
+   * @brief Call a function for every name in the network
+   * @param function called with the name and address, J1939_IDLE_ADDR if the name has no
+   * address. Is called while the network is locked for reading, so it must be quick and
+   * must not modify the network
+   */
+  template<typename Function> void for_each(Function &&function) const
+  {
+    std::shared_lock lock{ network_mtx_ };
+    for (auto &[name, address] : name_addr_map_) { function(name, address); }
+  }
+
+  /**
+   * @brief Call a function for every name that has an address
+   *
+   * The pairs are copied to the stack while the network is locked and the function is
+   * called after it is unlocked, so the function may take its time and modify the network.
+   * @param function called with the name and address
+   */
+  template<typename Function> void for_each_address(Function &&function) const
+  {
+    std::array<entry, J1939_MAX_UNICAST_ADDR + 1> entries{};
+    std::size_t count{ 0 };
+    {
+      std::shared_lock lock{ network_mtx_ };
+      for (auto &[address, name] : addr_name_map_) { entries[count++] = entry{ name, address }; }
+    }
+    for (std::size_t i = 0; i < count; i++) { function(entries[i].name, entries[i].address); }
+  }
+
+  /**
+   * @brief Copy all names and addresses into a buffer
+   * @param out buffer to copy to
+   * @param capacity of the buffer
+   * @return number of names in the network, only the first capacity are copied if it is larger
+   * so the buffer can be grown and the export retried
+   */
+  std::size_t export_entries(entry *out, std::size_t capacity) const
+  {
+    std::shared_lock lock{ network_mtx_ };
+    std::size_t count{ 0 };
+    for (auto &[name, address] : name_addr_map_) {
+      if (count < capacity) { out[count] = entry{ name, address }; }
+      count++;
+    }
+    return count;
+  }
+
   /// ##################### Map access ##################### ///
 
   /**
@@ -86,8 +189,19 @@ public:
       if (!in_network(name)) {
         std::scoped_lock lock{ network_mtx_ };
         name_addr_map_[name] = J1939_IDLE_ADDR;
+        add_to_index(name);
+        make_idle(name);
+        JAY_PROBE(network_insert, J1939_PGN_ADDRESS_CLAIMED, J1939_IDLE_ADDR, 6, name);
         return true;
       }
+
+      // Seen again, so it is the most recently idle
+      if (get_address(name) == J1939_IDLE_ADDR) {
+        std::scoped_lock lock{ network_mtx_ };
+        if (auto it = name_addr_map_.find(name); it != name_addr_map_.end() && it->second == J1939_IDLE_ADDR) {
+          make_idle(name);
+        }
+      }
       return false;
     }
 
@@ -95,18 +209,35 @@ public:
     if (match(name, address)) { return false; }
 
     std::scoped_lock lock{ network_mtx_ };
+
+    // Claiming an address gives up the previous one, whether the claim is won or lost
+    if (auto previous = name_addr_map_.find(name); previous != name_addr_map_.end()) {
+      auto it = addr_name_map_.find(previous->second);
+      if (it != addr_name_map_.end() && it->second == name) { addr_name_map_.erase(it); }
+    }
+
     if (auto it = addr_name_map_.find(address);
         it != addr_name_map_.end()) {// Their name is less than ours cant claim address
       if (it->second < name) {// Register device without an address
         name_addr_map_[name] = J1939_IDLE_ADDR;
+        add_to_index(name);
+        make_idle(name);
+        JAY_PROBE(network_insert, J1939_PGN_ADDRESS_CLAIMED, J1939_IDLE_ADDR, 6, name);
         return true;
       }
       // Address is larger can claim address, clear existing device address
       name_addr_map_[it->second] = J1939_IDLE_ADDR;
+      make_idle(it->second);
     }
 
     addr_name_map_[address] = name;
     name_addr_map_[name] = address;
+    add_to_index(name);
+    make_active(name);
+    JAY_PROBE(network_insert, J1939_PGN_ADDRESS_CLAIMED, address, 6, name);
+
+    // The claim counts as activity, so a controller is not lost before it sends its first frame
+    seen(address);
     return true;
   }
 
@@ -121,6 +252,8 @@ public:
     if (name_addr_map_.find(name) == name_addr_map_.end()) { return; }
     auto address = name_addr_map_[name];
     name_addr_map_[name] = J1939_IDLE_ADDR;
+    make_idle(name);
+    JAY_PROBE(network_release, J1939_PGN_ADDRESS_CLAIMED, address, 6, name);
 
     if (addr_name_map_.find(address) == addr_name_map_.end()) { return; }
     addr_name_map_.erase(address);
@@ -137,6 +270,8 @@ public:
     if (name_addr_map_.find(name) == name_addr_map_.end()) { return; }
     auto address = name_addr_map_[name];
     name_addr_map_.erase(name);
+    remove_from_index(name);
+    make_active(name);
 
     if (addr_name_map_.find(address) == addr_name_map_.end()) { return; }
     addr_name_map_.erase(address);
@@ -150,6 +285,98 @@ public:
     std::scoped_lock lock{ network_mtx_ };
     name_addr_map_.clear();
     addr_name_map_.clear();
+    idle_index_.clear();
+    idle_order_.clear();
+    field_index_.clear();
+  }
+
+  /**
+   * @brief Find the names that have a value in one of their fields
+   * @param field to match
+   * @param value the field must have
+   * @return names in the network with the value, with or without an address
+   * @note Takes time proportional to the number of names found
+   */
+  std::vector<jay::name> find_names(name_field field, std::uint16_t value) const
+  {
+    std::vector<jay::name> names{};
+    for_each_name(field, value, [&names](jay::name name) { names.push_back(name); });
+    return names;
+  }
+
+  /**
+   * @brief Call a function for every name that has a value in one of their fields
+   * @param field to match
+   * @param value the field must have
+   * @param function called with each name, while the network is locked for reading
+   * so it must not modify the network
+   */
+  template<typename Function> void for_each_name(name_field field, std::uint16_t value, Function &&function) const
+  {
+    std::shared_lock lock{ network_mtx_ };
+    if (auto it = field_index_.find(index_key(field, value)); it != field_index_.end()) {
+      for (auto &name : it->second) { function(name); }
+    }
+  }
+
+  /**
+   * @brief Remove names that have been without an address for longer than age
+   * @param age time without an address before a name is removed
+   * @param now current time
+   * @return number of names removed
+   */
+  std::size_t expire_idle(clock::duration age, clock::time_point now = clock::now())
+  {
+    std::scoped_lock lock{ network_mtx_ };
+    std::size_t removed{ 0 };
+    while (!idle_order_.empty() && now - idle_order_.back().since > age) {
+      evict();
+      removed++;
+    }
+    expired_ += removed;
+    return removed;
+  }
+
+  /**
+   * @brief Set the most names without an address that are kept
+   * @param capacity of names without an address, the least recently idle are removed if exceeded
+   */
+  void set_idle_capacity(std::size_t capacity)
+  {
+    std::scoped_lock lock{ network_mtx_ };
+    idle_capacity_ = capacity;
+    while (idle_order_.size() > idle_capacity_) {
+      evict();
+      evicted_++;
+    }
+  }
+
+  /**
+   * @brief Get memory use
+   * @return snapshot of the current memory use
+   * @note bytes is an estimate from the element and bucket counts, allocator overhead is not included
+   */
+  memory_stats get_memory_stats() const
+  {
+    std::shared_lock lock{ network_mtx_ };
+    // Unordered map nodes hold a next pointer and the cached hash besides the value, list nodes two pointers
+    constexpr std::size_t node = 2 * sizeof(void *);
+    auto bytes = name_addr_map_.bucket_count() * sizeof(void *)
+                 + name_addr_map_.size() * (node + sizeof(jay::name) + sizeof(std::uint8_t))
+                 + addr_name_map_.bucket_count() * sizeof(void *)
+                 + addr_name_map_.size() * (node + sizeof(std::uint8_t) + sizeof(jay::name))
+                 + idle_index_.bucket_count() * sizeof(void *)
+                 + idle_index_.size() * (node + sizeof(jay::name) + sizeof(idle_iterator))
+                 + idle_order_.size() * (node + sizeof(idle_entry))
+                 + field_index_.size() * (node + sizeof(std::uint32_t) + sizeof(field_index_.begin()->second))
+                 + index_keys(jay::name{}).size() * name_addr_map_.size() * (node + sizeof(jay::name));
+    return memory_stats{ name_addr_map_.size(),
+      addr_name_map_.size(),
+      idle_order_.size(),
+      idle_capacity_,
+      evicted_,
+      expired_,
+      bytes };
   }
 
   /**
@@ -288,6 +515,114 @@ public:
 
   /// TODO: Check the name of other devices and see if they can change their address
 
+  /// ##################### Liveness ##################### ///
+
+  /**
+   * @brief Record that a frame was received from an address
+   * @param address the frame was sent from
+   * @param now time the frame was received
+   * @note is lock free and can be called for every frame, as activity is kept in a
+   * table indexed by address that is separate from the names and addresses
+   */
+  void seen(std::uint8_t address, clock::time_point now = clock::now()) const noexcept
+  {
+    auto &entry = activity_[address];
+    entry.last_seen.store(now.time_since_epoch().count(), std::memory_order_relaxed);
+    entry.frames.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Get the time a frame was last received from an address
+   * @param address to check
+   * @return time of the last frame, or nullopt if no frame was received
+   */
+  std::optional<clock::time_point> last_seen(std::uint8_t address) const noexcept
+  {
+    auto ticks = activity_[address].last_seen.load(std::memory_order_relaxed);
+    if (ticks == never_seen) { return std::nullopt; }
+    return clock::time_point{ clock::duration{ ticks } };
+  }
+
+  /**
+   * @brief Get the number of frames received from an address
+   * @param address to check
+   * @return frame count
+   */
+  std::uint64_t frame_count(std::uint8_t address) const noexcept
+  {
+    return activity_[address].frames.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Release the addresses of controllers that have been silent
+   *
+   * Addresses are checked under a shared lock first, the exclusive lock is only taken if
+   * a controller was silent, and the callback is called after the lock is released.
+   * @param silence time without frames before a controller is lost
+   * @param on_lost called with the name and address of every released controller
+   * @param now current time
+   * @return number of controllers released
+   */
+  template<typename OnLost>
+  std::size_t release_silent(clock::duration silence, OnLost &&on_lost, clock::time_point now = clock::now())
+  {
+    return release_silent(silence, std::forward<OnLost>(on_lost), {}, now);
+  }
+
+  /**
+   * @brief Release the addresses of controllers that have been silent, except local controllers
+   *
+   * The frames of local controllers are usually not read back from the bus, so their
+   * activity is not recorded unless seen is called when they transmit.
+   * @param silence time without frames before a controller is lost
+   * @param on_lost called with the name and address of every released controller
+   * @param local names of local controllers, that are never released
+   * @param now current time
+   * @return number of controllers released
+   */
+  template<typename OnLost>
+  std::size_t release_silent(clock::duration silence,
+    OnLost &&on_lost,
+    const std::vector<jay::name> &local,
+    clock::time_point now = clock::now())
+  {
+    auto is_local = [&local](jay::name name) { return std::find(local.begin(), local.end(), name) != local.end(); };
+    auto silent = [this, limit = (now - silence).time_since_epoch().count()](std::uint8_t address) {
+      return activity_[address].last_seen.load(std::memory_order_relaxed) < limit;
+    };
+
+    std::array<std::pair<jay::name, std::uint8_t>, J1939_MAX_UNICAST_ADDR + 1> lost{};
+    std::size_t count{ 0 };
+    {
+      std::shared_lock lock{ network_mtx_ };
+      for (auto &[address, name] : addr_name_map_) {
+        if (silent(address) && !is_local(name)) { lost[count++] = { name, address }; }
+      }
+    }
+    if (count == 0) { return 0; }
+
+    std::size_t released{ 0 };
+    {
+      std::scoped_lock lock{ network_mtx_ };
+      for (std::size_t i = 0; i < count; i++) {
+        auto [name, address] = lost[i];
+
+        // Might have been claimed again, or sent a frame, since the shared lock was released
+        auto it = addr_name_map_.find(address);
+        if (it == addr_name_map_.end() || !(it->second == name) || !silent(address)) { continue; }
+
+        addr_name_map_.erase(it);
+        name_addr_map_[name] = J1939_IDLE_ADDR;
+        make_idle(name);
+        JAY_PROBE(network_release, J1939_PGN_ADDRESS_CLAIMED, address, 6, name);
+        lost[released++] = { name, address };
+      }
+    }
+
+    for (std::size_t i = 0; i < released; i++) { on_lost(lost[i].first, lost[i].second); }
+    return released;
+  }
+
   /**
    * @brief Get the name of the interface that this network is assosiated with
    * @return const std::string&
@@ -313,6 +648,92 @@ private:
     return J1939_NO_ADDR;
   }
 
+  /**
+   * @internal
+   * @brief Move a name without an address to the front of the idle order, and remove
+   * the least recently idle names if the capacity is exceeded
+   * @note network_mtx_ must be held exclusively
+   */
+  void make_idle(jay::name name)
+  {
+    make_active(name);
+    idle_order_.push_front(idle_entry{ name, clock::now() });
+    idle_index_[name] = idle_order_.begin();
+    while (idle_order_.size() > idle_capacity_) {
+      evict();
+      evicted_++;
+    }
+  }
+
+  /**
+   * @internal
+   * @brief Remove a name from the idle order
+   * @note network_mtx_ must be held exclusively
+   */
+  void make_active(jay::name name)
+  {
+    if (idle_index_.empty()) { return; }
+    if (auto it = idle_index_.find(name); it != idle_index_.end()) {
+      idle_order_.erase(it->second);
+      idle_index_.erase(it);
+    }
+  }
+
+  /**
+   * @internal
+   * @brief Remove the least recently idle name from the network
+   * @note network_mtx_ must be held exclusively
+   */
+  void evict()
+  {
+    auto name = idle_order_.back().name;
+    idle_index_.erase(name);
+    idle_order_.pop_back();
+    name_addr_map_.erase(name);
+    remove_from_index(name);
+  }
+
+  static constexpr std::uint32_t index_key(name_field field, std::uint16_t value) noexcept
+  {
+    return static_cast<std::uint32_t>(field) << 16 | value;
+  }
+
+  /**
+   * @internal
+   * @brief Get the index keys of all indexed fields of a name
+   */
+  static constexpr std::array<std::uint32_t, 5> index_keys(jay::name name) noexcept
+  {
+    return { index_key(name_field::function, name.function()),
+      index_key(name_field::function_instance, name.function_instance()),
+      index_key(name_field::device_class, name.device_class()),
+      index_key(name_field::manufacturer_code, name.manufacturer_code()),
+      index_key(name_field::industry_group, name.industry_group()) };
+  }
+
+  /**
+   * @internal
+   * @brief Add a name to the field index, does nothing if it is already indexed
+   * @note network_mtx_ must be held exclusively
+   */
+  void add_to_index(jay::name name)
+  {
+    for (auto key : index_keys(name)) { field_index_[key].insert(name); }
+  }
+
+  /**
+   * @internal
+   * @brief Remove a name from the field index
+   * @note network_mtx_ must be held exclusively. Empty sets are kept to avoid reallocating
+   * them when controllers come and go, there are at most a few thousand field values
+   */
+  void remove_from_index(jay::name name)
+  {
+    for (auto key : index_keys(name)) {
+      if (auto it = field_index_.find(key); it != field_index_.end()) { it->second.erase(name); }
+    }
+  }
+
 private:
   const std::string interface_name_{ "can0" };
 
@@ -323,7 +744,41 @@ private:
   std::unordered_map<jay::name, std::uint8_t, jay::name::hash> name_addr_map_{};
   std::unordered_map<std::uint8_t, jay::name> addr_name_map_{};
 
+  /**
+   * @internal
+   * @brief Name without an address and the time it became idle
+   */
+  struct idle_entry
+  {
+    jay::name name{};
+    clock::time_point since{};
+  };
+  using idle_iterator = std::list<idle_entry>::iterator;
+
+  std::size_t idle_capacity_;
+  std::list<idle_entry> idle_order_{}; /**< Most recently idle first */
+  std::unordered_map<jay::name, idle_iterator, jay::name::hash> idle_index_{};
+  std::uint64_t evicted_{ 0 };
+  std::uint64_t expired_{ 0 };
+
+  /// Names per field value, keyed on field << 16 | value
+  std::unordered_map<std::uint32_t, std::unordered_set<jay::name, jay::name::hash>> field_index_{};
+
   mutable std::shared_mutex network_mtx_{};
+
+  static constexpr clock::rep never_seen{ clock::duration::min().count() };
+
+  /**
+   * @internal
+   * @brief Activity of an address, written without the network lock
+   */
+  struct activity
+  {
+    std::atomic<clock::rep> last_seen{ never_seen };
+    std::atomic<std::uint64_t> frames{ 0 };
+  };
+
+  mutable std::array<activity, 256> activity_{}; /**< Indexed by address */
 };
 
 }// Namespace jay
@@ -18,6 +18,7 @@
 
 // Local
 #include "address_manager.hpp"
+#include "stage_histogram.hpp"
 
 namespace jay {
 
@@ -58,12 +59,15 @@ public:
    */
   void process(const jay::frame &frame)
   {
+    jay::stage_timer timer{};
+
     if (frame.header.is_claim()) {
       on_frame_address_claim(jay::name(frame.payload), frame.header.pdu_specific(), frame.header.source_adderess());
-      return;
+    } else if (frame.header.is_request()) {
+      on_frame_address_request(frame.header.pdu_specific());
     }
 
-    if (frame.header.is_request()) { on_frame_address_request(frame.header.pdu_specific()); }
+    timer.record(jay::stage::network_process);
   }
 
   /**
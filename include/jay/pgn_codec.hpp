@@ -0,0 +1,297 @@
+//
+// Copyright (c) 2022 Bjørn Fuglestad, Jaersense AS (bjorn@jaersense.no)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/bjorn-jaes/jay
+//
+
+#ifndef JAY_PGN_CODEC_H
+#define JAY_PGN_CODEC_H
+
+#pragma once
+
+// C++
+#include <algorithm>//std::min, std::max
+#include <array>//std::array
+#include <cstddef>//std::size_t
+#include <ratio>//std::ratio
+#include <type_traits>//std::is_same_v
+#include <utility>//std::index_sequence
+
+// Local
+#include "frame.hpp"// jay::frame, jay::payload
+
+namespace jay {
+
+/**
+ * @brief Load a payload as a 64-bit little endian word, byte 0 is bits 0 - 7
+ * @note Compiles to a single load on little endian targets
+ * @param payload to load
+ * @return payload word
+ */
+constexpr std::uint64_t to_word(const jay::payload &payload) noexcept
+{
+  return static_cast<std::uint64_t>(payload[0]) | static_cast<std::uint64_t>(payload[1]) << 8
+         | static_cast<std::uint64_t>(payload[2]) << 16 | static_cast<std::uint64_t>(payload[3]) << 24
+         | static_cast<std::uint64_t>(payload[4]) << 32 | static_cast<std::uint64_t>(payload[5]) << 40
+         | static_cast<std::uint64_t>(payload[6]) << 48 | static_cast<std::uint64_t>(payload[7]) << 56;
+}
+
+/**
+ * @brief Store a 64-bit little endian word as a payload
+ * @param word to store
+ * @return payload
+ */
+constexpr jay::payload to_payload(std::uint64_t word) noexcept
+{
+  return jay::payload{ static_cast<std::uint8_t>(word),
+    static_cast<std::uint8_t>(word >> 8),
+    static_cast<std::uint8_t>(word >> 16),
+    static_cast<std::uint8_t>(word >> 24),
+    static_cast<std::uint8_t>(word >> 32),
+    static_cast<std::uint8_t>(word >> 40),
+    static_cast<std::uint8_t>(word >> 48),
+    static_cast<std::uint8_t>(word >> 56) };
+}
+
+/**
+ * @brief Count the set bits in a word
+ * @param word to count bits in
+ * @return number of bits set
+ */
+constexpr std::size_t bit_count(std::uint64_t word) noexcept
+{
+  std::size_t count{ 0 };
+  for (; word != 0; word &= word - 1) { count++; }
+  return count;
+}
+
+/**
+ * @brief Get the position of a type in a parameter pack
+ * @tparam T to find, must be in Ts
+ * @tparam Ts to search
+ * @return index of T
+ */
+template<typename T, typename... Ts> constexpr std::size_t type_index() noexcept
+{
+  static_assert((std::is_same_v<T, Ts> || ...), "Type is not in the parameter pack");
+  constexpr bool matches[] = { std::is_same_v<T, Ts>... };
+  std::size_t i{ 0 };
+  while (!matches[i]) { i++; }
+  return i;
+}
+
+/**
+ * @brief Compile-time descriptor of a suspect parameter number (SPN) in a payload
+ *
+ * The physical value of the SPN is raw * scale + offset. Scale and offset are given as
+ * std::ratio as C++17 does not allow floating point template parameters.
+ *
+ * Example, engine speed in EEC1 (PGN 61444):
+ * using engine_speed = jay::spn<24, 16, std::ratio<1, 8>>; // 0.125 rpm/bit, bytes 4 - 5
+ *
+ * @tparam StartBit of the SPN in the payload word, byte 0 bit 0 is bit 0
+ * @tparam Length of the SPN in bits, 1 - 64
+ * @tparam Scale resolution of one raw bit
+ * @tparam Offset added after scaling
+ */
+template<std::uint8_t StartBit, std::uint8_t Length, typename Scale = std::ratio<1>, typename Offset = std::ratio<0>>
+struct spn
+{
+  static_assert(Length > 0 && Length <= 64, "SPN length must be between 1 and 64 bits");
+  static_assert(StartBit + Length <= 64, "SPN must fit in the 8 byte payload");
+  static_assert(Scale::num > 0, "SPN scale must be positive");
+
+  static constexpr std::uint8_t start_bit = StartBit;
+  static constexpr std::uint8_t length = Length;
+  static constexpr std::uint64_t mask = Length == 64 ? ~0ULL : (1ULL << Length) - 1;
+  static constexpr std::uint64_t word_mask = mask << StartBit;
+  static constexpr double scale = static_cast<double>(Scale::num) / static_cast<double>(Scale::den);
+  static constexpr double offset = static_cast<double>(Offset::num) / static_cast<double>(Offset::den);
+
+  /// Largest raw value that is exact as a double, mask rounds up to 2^Length above 53 bits
+  static constexpr double max_steps = static_cast<double>(mask - (mask >> 53));
+
+  /**
+   * @brief Extract the raw value from a payload word
+   * @param word payload as 64-bit word
+   * @return raw value
+   */
+  static constexpr std::uint64_t raw(std::uint64_t word) noexcept { return (word >> StartBit) & mask; }
+
+  /**
+   * @brief Insert a raw value into a payload word
+   * @param word payload as 64-bit word
+   * @param raw value, bits above length are discarded
+   * @return word with the raw value inserted
+   */
+  static constexpr std::uint64_t insert(std::uint64_t word, std::uint64_t raw) noexcept
+  {
+    return (word & ~word_mask) | ((raw & mask) << StartBit);
+  }
+
+  /**
+   * @brief Decode the physical value from a payload word
+   * @param word payload as 64-bit word
+   * @return raw * scale + offset
+   */
+  static constexpr double decode(std::uint64_t word) noexcept
+  {
+    // Skip identity scale and offset at compile time, adding 0.0 can not be optimized away
+    auto value = static_cast<double>(raw(word));
+    if constexpr (Scale::num != Scale::den) { value *= scale; }
+    if constexpr (Offset::num != 0) { value += offset; }
+    return value;
+  }
+
+  /**
+   * @brief Convert a physical value to its raw value
+   * @param value to convert, is clamped to the range the SPN can represent
+   * @return raw value rounded to the nearest resolution step, not available (all ones) for NaN.
+   * SPNs longer than 53 bits saturate at the largest raw value a double can hold exactly
+   */
+  static constexpr std::uint64_t to_raw(double value) noexcept
+  {
+    // NaN passes through min / max and can not be converted, std::isnan is not constexpr
+    if (value != value) { return mask; }
+
+    if constexpr (Offset::num != 0) { value -= offset; }
+    if constexpr (Scale::num != Scale::den) { value *= 1.0 / scale; }
+
+    // min / max instead of clamp so that it compiles to minsd / maxsd instead of branches
+    auto steps = std::min(std::max(value + 0.5, 0.0), max_steps);
+
+    // Signed conversion is a single instruction, unsigned is not
+    if constexpr (Length < 64) {
+      return static_cast<std::uint64_t>(static_cast<std::int64_t>(steps));
+    } else {
+      return static_cast<std::uint64_t>(steps);
+    }
+  }
+
+  /**
+   * @brief Encode a physical value into a payload word
+   * @param word payload as 64-bit word
+   * @param value to encode
+   * @return word with the value inserted
+   */
+  static constexpr std::uint64_t encode(std::uint64_t word, double value) noexcept
+  {
+    return insert(word, to_raw(value));
+  }
+};
+
+/**
+ * @brief Compile-time codec for a parameter group
+ *
+ * Decoding and encoding is done with shifts and masks on the payload as a 64-bit
+ * word, there are no branches or loops at runtime.
+ *
+ * Example:
+ * using actual_torque = jay::spn<16, 8, std::ratio<1>, std::ratio<-125>>;
+ * using engine_speed = jay::spn<24, 16, std::ratio<1, 8>>;
+ * using eec1 = jay::pgn_codec<0xF004, 3, actual_torque, engine_speed>;
+ * double rpm = eec1::get<engine_speed>(frame.payload);
+ * auto frame = eec1::make_frame({ 50.0, 1200.0 }, source_address);
+ *
+ * @tparam Pgn of the parameter group
+ * @tparam Priority default priority of the parameter group
+ * @tparam Spns in the parameter group, may not overlap
+ */
+template<pgn_t Pgn, priority_t Priority, typename... Spns> class pgn_codec
+{
+public:
+  static constexpr pgn_t pgn = Pgn;
+  static constexpr priority_t priority = Priority;
+  static constexpr std::size_t spn_count = sizeof...(Spns);
+
+  using values = std::array<double, spn_count>;
+  using raw_values = std::array<std::uint64_t, spn_count>;
+
+  /// Bits used by SPNs
+  static constexpr std::uint64_t used_mask = (Spns::word_mask | ... | 0ULL);
+
+  static_assert(Pgn <= 0x3FFFF, "PGN is only 18 bits");
+  static_assert(Priority <= 7, "Priority is only 3 bits");
+  static_assert((Spns::length + ... + 0) == bit_count(used_mask), "SPNs in a parameter group can not overlap");
+
+  /**
+   * @brief Get the index of an SPN in values
+   * @tparam Spn to get index of, must be part of the parameter group
+   */
+  template<typename Spn> static constexpr std::size_t index = type_index<Spn, Spns...>();
+
+  /**
+   * @brief Decode all SPNs
+   * @param payload of the frame
+   * @return physical values in the order of the SPNs
+   */
+  static constexpr values decode(const jay::payload &payload) noexcept
+  {
+    auto word = to_word(payload);
+    return values{ Spns::decode(word)... };
+  }
+
+  /**
+   * @brief Extract the raw value of all SPNs
+   * @param payload of the frame
+   * @return raw values in the order of the SPNs
+   */
+  static constexpr raw_values decode_raw(const jay::payload &payload) noexcept
+  {
+    auto word = to_word(payload);
+    return raw_values{ Spns::raw(word)... };
+  }
+
+  /**
+   * @brief Decode a single SPN
+   * @tparam Spn to decode, must be part of the parameter group
+   * @param payload of the frame
+   * @return physical value
+   */
+  template<typename Spn> static constexpr double get(const jay::payload &payload) noexcept
+  {
+    static_assert((std::is_same_v<Spn, Spns> || ...), "SPN is not part of the parameter group");
+    return Spn::decode(to_word(payload));
+  }
+
+  /**
+   * @brief Encode all SPNs
+   * @param physical values in the order of the SPNs
+   * @return payload, bits not used by any SPN are set to 1 (not available)
+   */
+  static constexpr jay::payload encode(const values &physical) noexcept
+  {
+    return to_payload(encode_word(physical, std::index_sequence_for<Spns...>{}));
+  }
+
+  /**
+   * @brief Create a frame containing the parameter group
+   * @param physical values in the order of the SPNs
+   * @param source_address of the frame
+   * @param destination_address of the frame, only used if the PGN is peer-to-peer
+   * @return frame
+   */
+  static constexpr jay::frame
+    make_frame(const values &physical, std::uint8_t source_address, std::uint8_t destination_address = J1939_NO_ADDR)
+  {
+    jay::frame frame{ jay::frame_header{ Priority, Pgn, source_address, 8 }, encode(physical) };
+    if (!frame.header.is_broadcast()) { frame.header.pdu_specific(destination_address); }
+    return frame;
+  }
+
+private:
+  template<std::size_t... I>
+  static constexpr std::uint64_t encode_word(const values &physical, std::index_sequence<I...>) noexcept
+  {
+    auto word = ~used_mask;
+    ((word |= Spns::to_raw(physical[I]) << Spns::start_bit), ...);
+    return word;
+  }
+};
+
+}// namespace jay
+
+#endif
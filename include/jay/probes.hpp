@@ -0,0 +1,71 @@
+//
+// Copyright (c) 2022 Bjørn Fuglestad, Jaersense AS (bjorn@jaersense.no)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/bjorn-jaes/jay
+//
+
+#ifndef JAY_PROBES_H
+#define JAY_PROBES_H
+
+#pragma once
+
+// C++
+#include <cstdint>//std::uint8_t, std::uint32_t, std::uint64_t
+
+/*
+ * USDT (user statically defined tracing) probes for perf, bpftrace and systemtap
+ *
+ * Probes are only compiled in if JAY_USDT is defined, use the CMake option of the same name.
+ * A probe is a single nop in the code and a note in the .note.stapsdt ELF section,
+ * so they cost nothing when no tracer is attached and survive inlining.
+ *
+ * All probes are in the "jay" provider and have the same arguments:
+ * arg0 : PGN (pgn_t)
+ * arg1 : Source address, or the address claimed / released
+ * arg2 : Priority
+ * arg3 : NAME of the local controller the event concerns, 0 if there is none
+ *
+ * Probe                  Location
+ * frame_receive          J1939Connection, frame read from the socket
+ * frame_enqueue          J1939Connection, frame passed to SendRaw
+ * frame_sent             J1939Connection, frame accepted by the socket
+ * claim_begin            address_claimer, entered claiming state
+ * claim_send             address_claimer, address claim is sent
+ * cannot_claim           address_claimer, cannot claim is sent
+ * address_gain           address_claimer, entered has address state
+ * address_loss           address_claimer, exited has address state
+ * network_insert         network, name inserted or address changed
+ * network_release        network, address of name released
+ *
+ * Address claim related probes use the address claimed PGN and its priority (6).
+ *
+ * Example:
+ * bpftrace -e 'usdt:./simple_example:jay:address_gain { printf("%x got %d\n", arg3, arg1); }'
+ */
+
+#ifdef JAY_USDT
+
+#if !__has_include(<sys/sdt.h>)
+#error "JAY_USDT requires sys/sdt.h, install systemtap-sdt-dev or disable JAY_USDT"
+#endif
+
+#include <sys/sdt.h>
+
+#define JAY_PROBE(probe, pgn, source_address, priority, name) \
+  STAP_PROBE4(jay,                                              \
+    probe,                                                      \
+    static_cast<std::uint32_t>(pgn),                            \
+    static_cast<std::uint8_t>(source_address),                  \
+    static_cast<std::uint8_t>(priority),                        \
+    static_cast<std::uint64_t>(name))
+
+#else
+
+#define JAY_PROBE(probe, pgn, source_address, priority, name) static_cast<void>(0)
+
+#endif// JAY_USDT
+
+#endif
@@ -0,0 +1,443 @@
+//
+// Copyright (c) 2022 Bjørn Fuglestad, Jaersense AS (bjorn@jaersense.no)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/bjorn-jaes/jay
+//
+
+#ifndef JAY_REQUEST_MANAGER_H
+#define JAY_REQUEST_MANAGER_H
+
+#pragma once
+
+// C++
+#include <algorithm>//std::min
+#include <array>//std::array
+#include <atomic>//std::atomic
+#include <chrono>//std::chrono::steady_clock
+#include <functional>//std::function
+#include <string>//std::string
+#include <unordered_map>//std::unordered_map
+#include <vector>//std::vector
+
+// Lib
+#include "boost/asio/bind_executor.hpp"//boost::asio::bind_executor
+#include "boost/asio/io_context.hpp"//boost::asio::io_context
+#include "boost/asio/post.hpp"//boost::asio::post
+#include "boost/asio/steady_timer.hpp"//boost::asio::steady_timer
+#include "boost/asio/strand.hpp"//boost::asio::strand
+
+// Local
+#include "frame.hpp"
+#include "network.hpp"
+
+namespace jay {
+
+/**
+ * @brief Requests parameter groups with the request PGN (0xEA00) and waits for the responses
+ *
+ * Identical requests that are in flight are coalesced into one request on the bus, and
+ * responses are matched to requests on PGN and source address. All requests share one
+ * timer that is set to the earliest deadline. Responses of slow changing PGNs, like
+ * component and software identification, can be cached so that repeated requests are
+ * answered without going on the bus. The latest response of a cached PGN also answers
+ * global requests for it. Acknowledgements (PGN 0xE800) to a request complete
+ * it right away, they are counted per controller.
+ *
+ * Frames read from the bus must be passed to process. Events are handled on a strand
+ * of the context, handlers are called from it.
+ * @note Only single frame responses are matched, as transport protocol is not implemented
+ */
+class request_manager
+{
+public:
+  using clock = std::chrono::steady_clock;
+
+  /// Response time for requests, J1939-21 allows 200 ms plus bus and processing time
+  static constexpr std::chrono::milliseconds default_timeout{ 1250 };
+
+  /**
+   * @brief Outcome of a request
+   */
+  enum class status
+  {
+    response, /**< Response received, or served from the cache */
+    timeout, /**< No response before the timeout */
+    no_address, /**< The local controller has no address, nothing was sent */
+    acknowledged, /**< Positive acknowledgement received instead of a response */
+    not_acknowledged, /**< Negative acknowledgement (NACK) received */
+    access_denied, /**< Access denied acknowledgement received */
+    cannot_respond /**< Cannot respond (busy) acknowledgement received */
+  };
+
+  /**
+   * @brief Called once when a request completes
+   * @note frame is the response or the acknowledgement, it is empty on timeout and no address
+   */
+  using handler = std::function<void(status, const jay::frame &)>;
+
+  /**
+   * @brief Callbacks used by the request manager
+   */
+  struct callbacks
+  {
+    // Called when a request frame needs to be sent
+    std::function<void(jay::frame)> on_frame;
+    // Called when an internal error occurs, used for debugging
+    std::function<void(std::string, const boost::system::error_code &)> on_error;
+  };
+
+  /**
+   * @brief Snapshot of request statistics
+   */
+  struct stats
+  {
+    std::uint64_t requests{}; /**< Calls to request */
+    std::uint64_t sent{}; /**< Request frames sent */
+    std::uint64_t coalesced{}; /**< Requests added to an identical request in flight */
+    std::uint64_t cache_hits{}; /**< Requests answered from the cache */
+    std::uint64_t responses{}; /**< Requests on the bus that got a response */
+    std::uint64_t timeouts{}; /**< Requests on the bus that timed out */
+    std::uint64_t acknowledgements{}; /**< Requests on the bus completed by an acknowledgement */
+    std::uint64_t cached{}; /**< Responses in the cache, expired responses are evicted on lookup and timeouts */
+  };
+
+  /**
+   * @brief Snapshot of acknowledgements to our requests from one controller
+   */
+  struct acknowledgement_counts
+  {
+    std::uint64_t acknowledged{}; /**< Positive acknowledgements */
+    std::uint64_t not_acknowledged{}; /**< Negative acknowledgements */
+    std::uint64_t access_denied{}; /**< Access denied acknowledgements */
+    std::uint64_t cannot_respond{}; /**< Cannot respond acknowledgements */
+  };
+
+  /**
+   * @brief Constructor
+   * @param context from boost asio
+   * @param name of the local controller that requests are sent from
+   * @param network containing name address pairs
+   * @note remember to add callbacks for getting data out of object
+   */
+  request_manager(boost::asio::io_context &context, jay::name name, const jay::network &network)
+    : strand_(boost::asio::make_strand(context)), timer_(strand_), name_(name), network_(network)
+  {}
+
+  /**
+   * @brief Constructor with callbacks
+   * @param context from boost asio
+   * @param name of the local controller that requests are sent from
+   * @param network containing name address pairs
+   * @param callbacks for getting data out of object
+   */
+  request_manager(boost::asio::io_context &context,
+    jay::name name,
+    const jay::network &network,
+    callbacks &&callbacks)
+    : strand_(boost::asio::make_strand(context)), timer_(strand_), name_(name), network_(network),
+      callbacks_(std::move(callbacks))
+  {}
+
+  /**
+   * @brief set the callbacks for the request mananger
+   * @param callbacks for getting data out of the object
+   */
+  void set_callbacks(callbacks &&callbacks) { callbacks_ = std::move(callbacks); }
+
+  /**
+   * @brief Cache responses of a PGN
+   * @param pgn to cache
+   * @param ttl time a response is served from the cache
+   * @note event is posted to context
+   */
+  void cache(pgn_t pgn, clock::duration ttl)
+  {
+    caching_.store(true, std::memory_order_relaxed);
+    boost::asio::post(strand_, [this, pgn, ttl]() -> void { cache_ttl_[pgn] = ttl; });
+  }
+
+  /**
+   * @brief Request a parameter group
+   * @param pgn to request
+   * @param destination address to request from, J1939_NO_ADDR requests from all controllers
+   * and completes on the first response
+   * @param on_complete called once with the outcome
+   * @param timeout for the response, coalesced requests complete with the request in flight
+   * @note event is posted to context
+   */
+  void request(pgn_t pgn, std::uint8_t destination, handler on_complete, clock::duration timeout = default_timeout)
+  {
+    boost::asio::post(strand_, [this, pgn, destination, on_complete = std::move(on_complete), timeout]() mutable {
+      on_request(pgn, destination, std::move(on_complete), timeout);
+    });
+  }
+
+  /**
+   * @brief Match a frame read from the bus to requests in flight
+   * @param frame read from the bus
+   * @note event is posted to context, only if there are requests in flight or PGNs are cached
+   */
+  void process(const jay::frame &frame)
+  {
+    if (in_flight_.load(std::memory_order_relaxed) == 0 && !caching_.load(std::memory_order_relaxed)) { return; }
+    boost::asio::post(strand_, [this, frame]() -> void { on_response(frame); });
+  }
+
+  /**
+   * @brief Get statistics
+   * @return snapshot of the current statistics
+   * @note is safe to call from any thread
+   */
+  stats get_stats() const noexcept
+  {
+    return stats{ requests_.load(std::memory_order_relaxed),
+      sent_.load(std::memory_order_relaxed),
+      coalesced_.load(std::memory_order_relaxed),
+      cache_hits_.load(std::memory_order_relaxed),
+      responses_.load(std::memory_order_relaxed),
+      timeouts_.load(std::memory_order_relaxed),
+      acknowledged_.load(std::memory_order_relaxed),
+      cached_.load(std::memory_order_relaxed) };
+  }
+
+  /**
+   * @brief Get acknowledgements to our requests sent by a controller
+   * @param address of the controller
+   * @return snapshot of the current counts
+   * @note is safe to call from any thread
+   */
+  acknowledgement_counts get_acknowledgements(std::uint8_t address) const noexcept
+  {
+    auto &counts = acknowledgements_[address];
+    return acknowledgement_counts{ counts[ACK_POSITIVE].load(std::memory_order_relaxed),
+      counts[ACK_NEGATIVE].load(std::memory_order_relaxed),
+      counts[ACK_ACCESS_DENIED].load(std::memory_order_relaxed),
+      counts[ACK_CANNOT_RESPOND].load(std::memory_order_relaxed) };
+  }
+
+private:
+  /**
+   * @internal
+   * @brief Request on the bus and the handlers waiting for it
+   */
+  struct pending
+  {
+    std::vector<handler> handlers{};
+    clock::time_point deadline{};
+  };
+
+  /**
+   * @internal
+   * @brief Cached response
+   */
+  struct cached
+  {
+    jay::frame frame{};
+    clock::time_point expires{};
+  };
+
+  static constexpr std::uint32_t make_key(pgn_t pgn, std::uint8_t address) noexcept { return (pgn << 8) | address; }
+
+  void on_request(pgn_t pgn, std::uint8_t destination, handler on_complete, clock::duration timeout)
+  {
+    requests_.fetch_add(1, std::memory_order_relaxed);
+    auto key = make_key(pgn, destination);
+
+    if (auto it = cache_.find(key); it != cache_.end()) {
+      if (clock::now() < it->second.expires) {
+        cache_hits_.fetch_add(1, std::memory_order_relaxed);
+        return on_complete(status::response, it->second.frame);
+      }
+      cache_.erase(it);
+      cached_.store(cache_.size(), std::memory_order_relaxed);
+    }
+
+    if (auto it = pending_.find(key); it != pending_.end()) {
+      coalesced_.fetch_add(1, std::memory_order_relaxed);
+      it->second.handlers.push_back(std::move(on_complete));
+      return;
+    }
+
+    auto address = network_.get_address(name_);
+    if (address > J1939_MAX_UNICAST_ADDR) { return on_complete(status::no_address, jay::frame{}); }
+
+    auto deadline = clock::now() + timeout;
+    pending_.emplace(key, pending{ { std::move(on_complete) }, deadline });
+    in_flight_.fetch_add(1, std::memory_order_relaxed);
+    sent_.fetch_add(1, std::memory_order_relaxed);
+    if (callbacks_.on_frame) { callbacks_.on_frame(jay::frame::make_request(pgn, destination, address)); }
+    schedule(deadline);
+  }
+
+  void on_response(const jay::frame &frame)
+  {
+    if (frame.header.is_acknowledgement()) { return on_acknowledgement(frame); }
+
+    auto pgn = frame.header.pgn();
+    auto source_address = frame.header.source_adderess();
+
+    // Responses are also stored as the response to a global request, which completes on the first response
+    if (auto ttl = cache_ttl_.find(pgn); ttl != cache_ttl_.end()) {
+      auto expires = clock::now() + ttl->second;
+      cache_[make_key(pgn, source_address)] = cached{ frame, expires };
+      cache_[make_key(pgn, J1939_NO_ADDR)] = cached{ frame, expires };
+      cached_.store(cache_.size(), std::memory_order_relaxed);
+    }
+
+    complete(make_key(pgn, source_address), status::response, frame);
+    complete(make_key(pgn, J1939_NO_ADDR), status::response, frame);
+  }
+
+  /**
+   * @internal
+   * @brief Complete a request with the outcome of an acknowledgement, so that a NACK
+   * fails the request after one round-trip instead of the timeout
+   * @note Acknowledgements to global requests are ignored, as other controllers may still respond
+   */
+  void on_acknowledgement(const jay::frame &frame)
+  {
+    auto control = frame.payload[0];
+    if (control > ACK_CANNOT_RESPOND) { return; }
+
+    // Acknowledgements are sent to global with the address of the requester in the payload,
+    // older controllers leave it as 0xFF or send the acknowledgement to the requester
+    auto requester = frame.header.pdu_specific() != J1939_NO_ADDR ? frame.header.pdu_specific() : frame.payload[4];
+    if (requester != J1939_NO_ADDR && requester != network_.get_address(name_)) { return; }
+
+    auto pgn = static_cast<pgn_t>(frame.payload[5]) | static_cast<pgn_t>(frame.payload[6]) << 8
+               | static_cast<pgn_t>(frame.payload[7]) << 16;
+    auto key = make_key(pgn, frame.header.source_adderess());
+    if (pending_.find(key) == pending_.end()) { return; }
+
+    acknowledgements_[frame.header.source_adderess()][control].fetch_add(1, std::memory_order_relaxed);
+    constexpr std::array<status, 4> results{
+      status::acknowledged, status::not_acknowledged, status::access_denied, status::cannot_respond
+    };
+    complete(key, results[control], frame);
+  }
+
+  /**
+   * @internal
+   * @brief Remove a request in flight and call its handlers
+   */
+  void complete(std::uint32_t key, status result, const jay::frame &frame)
+  {
+    auto it = pending_.find(key);
+    if (it == pending_.end()) { return; }
+
+    auto handlers = std::move(it->second.handlers);
+    pending_.erase(it);
+    in_flight_.fetch_sub(1, std::memory_order_relaxed);
+    switch (result) {
+    case status::response:
+      responses_.fetch_add(1, std::memory_order_relaxed);
+      break;
+    case status::timeout:
+      timeouts_.fetch_add(1, std::memory_order_relaxed);
+      break;
+    default:
+      acknowledged_.fetch_add(1, std::memory_order_relaxed);
+      break;
+    }
+    for (auto &on_complete : handlers) { on_complete(result, frame); }
+  }
+
+  /**
+   * @internal
+   * @brief Move the shared timer forward if the deadline is earlier than the current one
+   */
+  void schedule(clock::time_point deadline)
+  {
+    if (timer_armed_ && deadline >= timer_.expiry()) { return; }
+    timer_armed_ = true;
+    timer_.expires_at(deadline);
+    timer_.async_wait(boost::asio::bind_executor(strand_, [this](auto error_code) {
+      if (error_code) { return on_fail("on_request_timeout", error_code); }
+      on_timeout();
+    }));
+  }
+
+  void on_timeout()
+  {
+    timer_armed_ = false;
+    auto now = clock::now();
+
+    std::vector<std::uint32_t> expired{};
+    auto next = clock::time_point::max();
+    for (auto &[key, request] : pending_) {
+      if (request.deadline <= now) {
+        expired.push_back(key);
+      } else {
+        next = std::min(next, request.deadline);
+      }
+    }
+
+    for (auto key : expired) { complete(key, status::timeout, jay::frame{}); }
+    if (next != clock::time_point::max()) { schedule(next); }
+    evict(now);
+  }
+
+  /**
+   * @internal
+   * @brief Remove expired responses from the cache
+   */
+  void evict(clock::time_point now)
+  {
+    for (auto it = cache_.begin(); it != cache_.end();) {
+      if (it->second.expires <= now) {
+        it = cache_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    cached_.store(cache_.size(), std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Checks the for ignorable errors. Errors cant be ignored
+   * the error code is sent to the on_error callback
+   *
+   * @param what - function name the error happened in
+   * @param error_code - containing information regarding the error
+   */
+  void on_fail(char const *what, boost::system::error_code error_code)
+  {
+    // Don't report these
+    if (error_code == boost::asio::error::operation_aborted) { return; }
+    if (callbacks_.on_error) { callbacks_.on_error(what, error_code); }
+  }
+
+private:
+  // Internal
+  boost::asio::strand<boost::asio::io_context::executor_type> strand_;
+  boost::asio::steady_timer timer_;
+  bool timer_armed_{ false };
+
+  // Injected
+  jay::name name_;
+  const jay::network &network_;
+  callbacks callbacks_{};
+
+  std::unordered_map<std::uint32_t, pending> pending_{}; /**< Keyed on PGN << 8 | destination address */
+  std::unordered_map<std::uint32_t, cached> cache_{}; /**< Keyed on PGN << 8 | source address, or 0xFF */
+  std::unordered_map<pgn_t, clock::duration> cache_ttl_{};
+
+  std::atomic<std::size_t> in_flight_{ 0 };
+  std::atomic<bool> caching_{ false };
+  std::atomic<std::uint64_t> requests_{ 0 };
+  std::atomic<std::uint64_t> sent_{ 0 };
+  std::atomic<std::uint64_t> coalesced_{ 0 };
+  std::atomic<std::uint64_t> cache_hits_{ 0 };
+  std::atomic<std::uint64_t> responses_{ 0 };
+  std::atomic<std::uint64_t> timeouts_{ 0 };
+  std::atomic<std::uint64_t> acknowledged_{ 0 };
+  std::atomic<std::size_t> cached_{ 0 };
+  std::array<std::array<std::atomic<std::uint64_t>, 4>, 256> acknowledgements_{}; /**< Per source address and control */
+};
+
+}// namespace jay
+
+#endif
@@ -0,0 +1,366 @@
+//
+// Copyright (c) 2022 Bjørn Fuglestad, Jaersense AS (bjorn@jaersense.no)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/bjorn-jaes/jay
+//
+
+#ifndef JAY_SIGNAL_DATABASE_H
+#define JAY_SIGNAL_DATABASE_H
+
+#pragma once
+
+// C++
+#include <algorithm>//std::max
+#include <array>//std::array
+#include <cctype>//std::isdigit
+#include <cstdint>//std::uint16_t, std::uint64_t
+#include <fstream>//std::ifstream
+#include <istream>//std::istream
+#include <optional>//std::optional
+#include <sstream>//std::istringstream
+#include <stdexcept>//std::invalid_argument
+#include <string>//std::string
+#include <vector>//std::vector
+
+// Local
+#include "frame.hpp"// jay::frame
+#include "pgn_codec.hpp"// jay::to_word
+
+namespace jay {
+
+/**
+ * @brief Signal definition loaded from a signal database
+ */
+struct signal
+{
+  std::string name{}; /**< Name of the signal */
+  std::string message{}; /**< Name of the message (parameter group) the signal is part of */
+  std::string unit{}; /**< Unit of the physical value */
+  pgn_t pgn{}; /**< PGN of the message */
+  std::uint8_t start_bit{}; /**< Start bit in the payload word, byte 0 bit 0 is bit 0 */
+  std::uint8_t length{}; /**< Length in bits */
+  bool is_signed{}; /**< If the raw value is two's complement */
+  double scale{ 1.0 }; /**< Resolution of one raw bit */
+  double offset{ 0.0 }; /**< Added after scaling */
+  double minimum{}; /**< Minimum physical value */
+  double maximum{}; /**< Maximum physical value */
+};
+
+/**
+ * @brief Signal database that decodes frames with flat per-PGN decode programs
+ *
+ * The database is loaded from a DBC file, only the subset needed for J1939 is supported:
+ *
+ * BO_ 2364540158 EEC1: 8 Vector__XXX
+ *  SG_ EngineSpeed : 24|16@1+ (0.125,0) [0|8031.875] "rpm" Vector__XXX
+ *
+ * The message id is the 29-bit CAN id (bit 31 is the DBC extended flag), messages are
+ * keyed on the PGN of the id so the source address is ignored. Only little endian (@1)
+ * signals within the first 8 bytes are supported as J1939 is little endian. Messages
+ * that are not extended frames, such as 11-bit diagnostic messages and the
+ * VECTOR__INDEPENDENT_SIG_MSG pseudo message, are skipped together with their signals.
+ * Multiplexed signals are skipped, the multiplexer switch is decoded as a plain signal.
+ * Skipped definitions are counted, see skipped_messages and skipped_signals.
+ * All other DBC sections are ignored.
+ *
+ * When loaded each PGN is compiled into a program, a contiguous run of decode operations.
+ * Programs are found through a two level table indexed by the PGN, so decoding a frame
+ * is two array loads followed by one shift, mask and multiply-add per signal.
+ * @note Is not thread safe while loading, decoding from multiple threads is safe
+ */
+class signal_database
+{
+public:
+  /**
+   * @brief Decode program of a parameter group
+   */
+  struct program
+  {
+    std::uint32_t first{}; /**< Index of the first signal and operation */
+    std::uint32_t count{}; /**< Number of signals */
+  };
+
+  signal_database() = default;
+
+  /**
+   * @brief Load a database from a stream
+   * @param stream containing DBC data
+   * @return loaded database
+   * @throw std::invalid_argument if the stream contains malformed definitions
+   */
+  static signal_database load(std::istream &stream)
+  {
+    signal_database database{};
+    std::string line{};
+    std::size_t line_number{ 0 };
+    std::vector<jay::signal> message{};
+    std::string message_name{};
+    pgn_t pgn{};
+    bool skip_message{ false };
+
+    auto flush = [&]() {
+      if (!skip_message) { database.add(message); }
+      message.clear();
+      skip_message = false;
+    };
+
+    while (std::getline(stream, line)) {
+      line_number++;
+      auto begin = line.find_first_not_of(" \t");
+      if (begin == std::string::npos) { continue; }
+
+      if (line.compare(begin, 4, "BO_ ") == 0) {
+        flush();
+        // Messages are keyed on PGN, the first definition wins
+        auto message_pgn = parse_message(line, line_number, message_name);
+        skip_message = !message_pgn || database.find(*message_pgn) != nullptr;
+        if (skip_message) {
+          database.skipped_messages_++;
+        } else {
+          pgn = *message_pgn;
+        }
+        continue;
+      }
+
+      if (line.compare(begin, 4, "SG_ ") == 0) {
+        if (message_name.empty()) { throw error(line_number, "signal outside of message"); }
+        auto signal = parse_signal(line, line_number, message_name, pgn);
+        if (skip_message || !signal) {
+          database.skipped_signals_++;
+        } else {
+          message.push_back(std::move(*signal));
+        }
+      }
+    }
+    flush();
+    return database;
+  }
+
+  /**
+   * @brief Load a database from a file
+   * @param path to the DBC file
+   * @return loaded database
+   * @throw std::invalid_argument if the file can't be opened or contains invalid definitions
+   */
+  static signal_database load_file(const std::string &path)
+  {
+    std::ifstream file{ path };
+    if (!file) { throw std::invalid_argument("Could not open signal database: " + path); }
+    return load(file);
+  }
+
+  /**
+   * @brief Get the decode program of a PGN
+   * @param pgn to get program for
+   * @return program or nullptr if the PGN is not in the database
+   */
+  const program *find(pgn_t pgn) const noexcept
+  {
+    if (pgn >= pgn_count) { return nullptr; }
+    auto page = pages_[pgn >> page_bits];
+    if (page == 0) { return nullptr; }
+    auto index = page_entries_[(page - 1) * page_size + (pgn & page_mask)];
+    return index == 0 ? nullptr : &programs_[index - 1];
+  }
+
+  /**
+   * @brief Decode all signals of a frame in one pass
+   * @param frame to decode
+   * @param values output, must have room for max_signals() values. values[i] is
+   * the physical value of signals()[program.first + i]
+   * @return the program used, nullptr if the PGN of the frame is not in the database
+   */
+  const program *decode(const jay::frame &frame, double *values) const noexcept
+  {
+    auto *prog = find(frame.header.pgn());
+    if (prog == nullptr) { return nullptr; }
+
+    auto word = jay::to_word(frame.payload);
+    auto *op = &operations_[prog->first];
+    for (std::uint32_t i = 0; i < prog->count; i++, op++) {
+      // Sign extension without branching, sign is 0 for unsigned signals
+      auto raw = (word >> op->shift) & op->mask;
+      auto value = static_cast<std::int64_t>((raw ^ op->sign) - op->sign);
+      values[i] = static_cast<double>(value) * op->scale + op->offset;
+    }
+    return prog;
+  }
+
+  /**
+   * @brief Get all signals, signals of a PGN are stored contiguously
+   * @return signals
+   */
+  const std::vector<jay::signal> &signals() const noexcept { return signals_; }
+
+  /**
+   * @brief Get the number of PGNs in the database
+   * @return message count
+   */
+  std::size_t message_count() const noexcept { return programs_.size(); }
+
+  /**
+   * @brief Get the largest number of signals in a PGN
+   * @return size values passed to decode must have
+   */
+  std::size_t max_signals() const noexcept { return max_signals_; }
+
+  /**
+   * @brief Get the number of messages that were not loaded, either because they are not
+   * extended frames or because their PGN was already defined
+   * @return skipped message count
+   */
+  std::size_t skipped_messages() const noexcept { return skipped_messages_; }
+
+  /**
+   * @brief Get the number of signals that were not loaded, including the signals of skipped messages
+   * @return skipped signal count
+   */
+  std::size_t skipped_signals() const noexcept { return skipped_signals_; }
+
+private:
+  static constexpr pgn_t pgn_count = 1U << 18;
+  static constexpr pgn_t page_bits = 8;
+  static constexpr pgn_t page_size = 1U << page_bits;
+  static constexpr pgn_t page_mask = page_size - 1;
+
+  /**
+   * @internal
+   * @brief Decode operation of a single signal
+   */
+  struct operation
+  {
+    std::uint64_t mask{};
+    std::uint64_t sign{};
+    double scale{};
+    double offset{};
+    std::uint8_t shift{};
+  };
+
+  static std::invalid_argument error(std::size_t line_number, const std::string &what)
+  {
+    return std::invalid_argument("Signal database line " + std::to_string(line_number) + ": " + what);
+  }
+
+  /**
+   * @internal
+   * @brief Parse "BO_ <id> <name>: <dlc> <transmitter>"
+   * @return PGN of the message, empty if the message is not a J1939 message
+   */
+  static std::optional<pgn_t> parse_message(const std::string &line, std::size_t line_number, std::string &name)
+  {
+    std::istringstream stream{ line };
+    std::string tag{};
+    std::uint64_t id{};
+    if (!(stream >> tag >> id >> name) || name.back() != ':') { throw error(line_number, "invalid message"); }
+    name.pop_back();
+
+    // DBC marks extended ids with bit 31, J1939 is always extended. Standard ids and
+    // pseudo messages such as VECTOR__INDEPENDENT_SIG_MSG (0xC0000000) are not J1939
+    if ((id & 0x8000'0000U) == 0 || (id & 0x7FFF'FFFFU) > 0x1FFF'FFFFU) { return std::nullopt; }
+    return jay::frame_header{ static_cast<std::uint32_t>(id) }.pgn();
+  }
+
+  /**
+   * @internal
+   * @brief Parse "SG_ <name> [M|m<value>] : <start>|<length>@<order><sign> (<scale>,<offset>) [<min>|<max>] ..."
+   * @return signal, empty if the signal is not supported
+   */
+  static std::optional<jay::signal>
+    parse_signal(const std::string &line, std::size_t line_number, const std::string &message, pgn_t pgn)
+  {
+    std::istringstream stream{ line };
+    jay::signal signal{};
+    signal.message = message;
+    signal.pgn = pgn;
+
+    std::string tag{};
+    std::string colon{};
+    if (!(stream >> tag >> signal.name >> colon)) { throw error(line_number, "invalid signal"); }
+
+    // Multiplexer indicator, the switch (M) is a plain signal, multiplexed signals (m<value>) are skipped
+    bool multiplexed{ false };
+    if (colon != ":") {
+      multiplexed = colon.size() > 1 && colon.front() == 'm' && std::isdigit(static_cast<unsigned char>(colon[1]));
+      if (!multiplexed && colon != "M") { throw error(line_number, "invalid multiplexer of signal " + signal.name); }
+      if (!(stream >> colon) || colon != ":") { throw error(line_number, "invalid signal " + signal.name); }
+    }
+
+    unsigned start{};
+    unsigned length{};
+    char bar{};
+    char at{};
+    char order{};
+    char sign{};
+    char open{};
+    char comma{};
+    char close{};
+    if (!(stream >> start >> bar >> length >> at >> order >> sign >> open >> signal.scale >> comma >> signal.offset
+            >> close)
+        || bar != '|' || at != '@' || open != '(' || comma != ',' || close != ')' || (sign != '+' && sign != '-')) {
+      throw error(line_number, "invalid signal " + signal.name);
+    }
+    if (length == 0 || (order != '0' && order != '1')) { throw error(line_number, "invalid signal " + signal.name); }
+
+    if (stream >> open >> signal.minimum >> bar >> signal.maximum >> close) {
+      std::string unit{};
+      if (std::getline(stream >> std::ws, unit, '"') && std::getline(stream, unit, '"')) { signal.unit = unit; }
+    }
+
+    // Big endian signals and signals beyond the first 8 bytes (multi-packet messages) are not supported
+    if (multiplexed || order != '1' || start + length > 64) { return std::nullopt; }
+
+    signal.start_bit = static_cast<std::uint8_t>(start);
+    signal.length = static_cast<std::uint8_t>(length);
+    signal.is_signed = sign == '-';
+    return signal;
+  }
+
+  /**
+   * @internal
+   * @brief Compile the signals of a message into a program
+   */
+  void add(const std::vector<jay::signal> &message)
+  {
+    if (message.empty()) { return; }
+
+    auto pgn = message.front().pgn;
+    auto &page = pages_[pgn >> page_bits];
+    if (page == 0) {
+      page_entries_.resize(page_entries_.size() + page_size, 0);
+      page = static_cast<std::uint16_t>(page_entries_.size() / page_size);
+    }
+
+    programs_.push_back(
+      program{ static_cast<std::uint32_t>(operations_.size()), static_cast<std::uint32_t>(message.size()) });
+    page_entries_[(page - 1) * page_size + (pgn & page_mask)] = static_cast<std::uint32_t>(programs_.size());
+    max_signals_ = std::max(max_signals_, message.size());
+
+    for (auto &signal : message) {
+      operation op{};
+      op.mask = signal.length == 64 ? ~0ULL : (1ULL << signal.length) - 1;
+      op.sign = signal.is_signed ? 1ULL << (signal.length - 1) : 0;
+      op.scale = signal.scale;
+      op.offset = signal.offset;
+      op.shift = signal.start_bit;
+      operations_.push_back(op);
+      signals_.push_back(signal);
+    }
+  }
+
+private:
+  std::array<std::uint16_t, (pgn_count >> page_bits)> pages_{}; /**< Page + 1 of each PGN page, 0 if none */
+  std::vector<std::uint32_t> page_entries_{}; /**< Program + 1 of each PGN, 0 if none */
+  std::vector<program> programs_{};
+  std::vector<operation> operations_{};
+  std::vector<jay::signal> signals_{};
+  std::size_t max_signals_{ 0 };
+  std::size_t skipped_messages_{ 0 };
+  std::size_t skipped_signals_{ 0 };
+};
+
+}// namespace jay
+
+#endif
@@ -0,0 +1,256 @@
+//
+// Copyright (c) 2022 Bjørn Fuglestad, Jaersense AS (bjorn@jaersense.no)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/bjorn-jaes/jay
+//
+
+#ifndef JAY_SPN_COLUMNS_H
+#define JAY_SPN_COLUMNS_H
+
+#pragma once
+
+// C++
+#include <cstdint>//std::uint8_t, std::uint64_t
+#include <limits>//std::numeric_limits
+#include <type_traits>//std::is_same_v
+
+// Local
+#include "frame_columns.hpp"// jay::frame_columns, JAY_COLUMNS_AVX2, JAY_COLUMNS_NEON
+
+namespace jay {
+
+/**
+ * @brief Get the largest raw value of an SPN that is a valid value
+ *
+ * J1939-71 reserves the top of the range of every SPN as indicators. For SPNs of whole
+ * bytes the most significant byte 0xFB - 0xFD is reserved, 0xFE is error and 0xFF not
+ * available, so the largest valid value is 0xFA followed by 0xFF bytes. For discrete
+ * SPNs of 2 or more bits the two highest values are error and not available.
+ * @param length of the SPN in bits
+ * @return largest valid raw value
+ */
+constexpr std::uint64_t spn_valid_max(std::uint8_t length) noexcept
+{
+  auto mask = length >= 64 ? ~0ULL : (1ULL << length) - 1;
+  if (length < 2) { return mask; }
+  if (length % 8 != 0) { return mask - 2; }
+  return (0xFAULL << (length - 8)) | (mask >> 8);
+}
+
+/**
+ * @brief Runtime description of an SPN for column scaling
+ */
+struct spn_scaling
+{
+  std::uint8_t start_bit{}; /**< Start bit in the payload word, byte 0 bit 0 is bit 0 */
+  std::uint8_t length{ 8 }; /**< Length in bits */
+  double scale{ 1.0 }; /**< Resolution of one raw bit */
+  double offset{ 0.0 }; /**< Added after scaling */
+
+  /**
+   * @brief Get the scaling of a compile-time SPN
+   * @tparam Spn jay::spn descriptor
+   * @return scaling
+   */
+  template<typename Spn> static constexpr spn_scaling of() noexcept
+  {
+    return spn_scaling{ Spn::start_bit, Spn::length, Spn::scale, Spn::offset };
+  }
+};
+
+namespace detail {
+
+/**
+ * @internal
+ * @brief Scale rows [first, count) one value at a time
+ * @param pgns column to filter on, nullptr to convert all rows
+ */
+template<typename T>
+inline void scale_column_scalar(const std::uint64_t *payload,
+  const pgn_t *pgns,
+  pgn_t pgn,
+  std::size_t first,
+  std::size_t count,
+  const spn_scaling &spn,
+  T *out) noexcept
+{
+  const auto mask = spn.length >= 64 ? ~0ULL : (1ULL << spn.length) - 1;
+  const auto valid_max = spn_valid_max(spn.length);
+  for (std::size_t i = first; i < count; i++) {
+    auto raw = (payload[i] >> spn.start_bit) & mask;
+    auto valid = raw <= valid_max && (pgns == nullptr || pgns[i] == pgn);
+    out[i] = valid ? static_cast<T>(static_cast<double>(raw) * spn.scale + spn.offset)
+                   : std::numeric_limits<T>::quiet_NaN();
+  }
+}
+
+#if defined(JAY_COLUMNS_AVX2)
+
+/**
+ * @internal
+ * @brief Scale 4 rows per iteration with AVX2
+ * @return number of rows scaled, the remainder is left for the scalar path
+ */
+template<typename T>
+inline std::size_t scale_column_simd(const std::uint64_t *payload,
+  const pgn_t *pgns,
+  pgn_t pgn,
+  std::size_t count,
+  const spn_scaling &spn,
+  T *out) noexcept
+{
+  // AVX2 has no 64-bit integer to double conversion, raw values are converted by placing
+  // them in the mantissa of 2^52, which is exact for values shorter than 52 bits
+  if (spn.length > 52) { return 0; }
+
+  const auto shift = _mm_cvtsi32_si128(spn.start_bit);
+  const auto mask = _mm256_set1_epi64x(static_cast<std::int64_t>((1ULL << spn.length) - 1));
+  const auto valid_max = _mm256_set1_epi64x(static_cast<std::int64_t>(spn_valid_max(spn.length)));
+  const auto exponent = _mm256_set1_epi64x(0x4330'0000'0000'0000);
+  const auto two_52 = _mm256_set1_pd(4503599627370496.0);
+  const auto scale = _mm256_set1_pd(spn.scale);
+  const auto offset = _mm256_set1_pd(spn.offset);
+  const auto nan = _mm256_set1_pd(std::numeric_limits<double>::quiet_NaN());
+  const auto filter = _mm_set1_epi32(static_cast<int>(pgn));
+  const auto ones = _mm256_set1_epi64x(-1);
+
+  std::size_t i{ 0 };
+  for (; i + 4 <= count; i += 4) {
+    auto word = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(payload + i));
+    auto raw = _mm256_and_si256(_mm256_srl_epi64(word, shift), mask);
+    auto invalid = _mm256_cmpgt_epi64(raw, valid_max);
+    if (pgns != nullptr) {
+      auto match = _mm_cmpeq_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pgns + i)), filter);
+      invalid = _mm256_or_si256(invalid, _mm256_xor_si256(_mm256_cvtepi32_epi64(match), ones));
+    }
+
+    auto value = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(raw, exponent)), two_52);
+    value = _mm256_add_pd(_mm256_mul_pd(value, scale), offset);
+    value = _mm256_blendv_pd(value, nan, _mm256_castsi256_pd(invalid));
+
+    if constexpr (std::is_same_v<T, double>) {
+      _mm256_storeu_pd(out + i, value);
+    } else {
+      _mm_storeu_ps(out + i, _mm256_cvtpd_ps(value));
+    }
+  }
+  return i;
+}
+
+#elif defined(JAY_COLUMNS_NEON) && defined(__aarch64__)
+
+/**
+ * @internal
+ * @brief Scale 2 rows per iteration with NEON, double precision vectors are only available on aarch64
+ * @return number of rows scaled, the remainder is left for the scalar path
+ */
+template<typename T>
+inline std::size_t scale_column_simd(const std::uint64_t *payload,
+  const pgn_t *pgns,
+  pgn_t pgn,
+  std::size_t count,
+  const spn_scaling &spn,
+  T *out) noexcept
+{
+  const auto shift = vdupq_n_s64(-static_cast<std::int64_t>(spn.start_bit));
+  const auto mask = vdupq_n_u64(spn.length >= 64 ? ~0ULL : (1ULL << spn.length) - 1);
+  const auto valid_max = vdupq_n_u64(spn_valid_max(spn.length));
+  const auto scale = vdupq_n_f64(spn.scale);
+  const auto offset = vdupq_n_f64(spn.offset);
+  const auto nan = vdupq_n_f64(std::numeric_limits<double>::quiet_NaN());
+  const auto filter = vdup_n_u32(pgn);
+
+  std::size_t i{ 0 };
+  for (; i + 2 <= count; i += 2) {
+    auto raw = vandq_u64(vshlq_u64(vld1q_u64(payload + i), shift), mask);
+    auto valid = vcleq_u64(raw, valid_max);
+    if (pgns != nullptr) {
+      // Sign extension widens the all ones compare result to 64 bits
+      auto match = vmovl_s32(vreinterpret_s32_u32(vceq_u32(vld1_u32(pgns + i), filter)));
+      valid = vandq_u64(valid, vreinterpretq_u64_s64(match));
+    }
+
+    auto value = vaddq_f64(vmulq_f64(vcvtq_f64_u64(raw), scale), offset);
+    value = vbslq_f64(valid, value, nan);
+
+    if constexpr (std::is_same_v<T, double>) {
+      vst1q_f64(out + i, value);
+    } else {
+      vst1_f32(out + i, vcvt_f32_f64(value));
+    }
+  }
+  return i;
+}
+
+#endif
+
+template<typename T>
+inline void scale_column(const std::uint64_t *payload,
+  const pgn_t *pgns,
+  pgn_t pgn,
+  std::size_t count,
+  const spn_scaling &spn,
+  T *out) noexcept
+{
+  static_assert(std::is_same_v<T, double> || std::is_same_v<T, float>, "SPNs can only be scaled to float or double");
+#if defined(JAY_COLUMNS_AVX2) || (defined(JAY_COLUMNS_NEON) && defined(__aarch64__))
+  scale_column_scalar(payload, pgns, pgn, scale_column_simd(payload, pgns, pgn, count, spn, out), count, spn, out);
+#else
+  scale_column_scalar(payload, pgns, pgn, 0, count, spn, out);
+#endif
+}
+
+}// namespace detail
+
+/**
+ * @brief Convert an SPN of every row in the columns to its physical value
+ *
+ * Computes raw * scale + offset with AVX2 or NEON when the target supports it, see
+ * frame_columns::simd. Raw values above spn_valid_max (error, not available and reserved
+ * indicators) are converted to NaN.
+ * @param columns decoded with decode_columns
+ * @param spn to convert
+ * @param out physical values, must have room for columns.size() values
+ */
+template<typename T> inline void scale_column(const frame_columns &columns, const spn_scaling &spn, T *out) noexcept
+{
+  detail::scale_column(columns.payload.data(), nullptr, 0, columns.size(), spn, out);
+}
+
+/**
+ * @brief Convert an SPN of a parameter group to its physical value
+ *
+ * Like scale_column(const frame_columns &, const spn_scaling &, T *) but rows of other
+ * PGNs are also converted to NaN, so that columns of mixed traffic can be converted without
+ * filtering them first.
+ * @param columns decoded with decode_columns
+ * @param pgn of the parameter group the SPN is part of
+ * @param spn to convert
+ * @param out physical values, must have room for columns.size() values
+ */
+template<typename T>
+inline void scale_column(const frame_columns &columns, pgn_t pgn, const spn_scaling &spn, T *out) noexcept
+{
+  detail::scale_column(columns.payload.data(), columns.pgn.data(), pgn, columns.size(), spn, out);
+}
+
+/**
+ * @brief Convert an SPN one row at a time
+ * @note Reference for scale_column, which should be used instead
+ * @param columns decoded with decode_columns
+ * @param pgn of the parameter group the SPN is part of
+ * @param spn to convert
+ * @param out physical values, must have room for columns.size() values
+ */
+template<typename T>
+inline void scale_column_scalar(const frame_columns &columns, pgn_t pgn, const spn_scaling &spn, T *out) noexcept
+{
+  detail::scale_column_scalar(columns.payload.data(), columns.pgn.data(), pgn, 0, columns.size(), spn, out);
+}
+
+}// namespace jay
+
+#endif
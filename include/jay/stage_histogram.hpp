@@ -0,0 +1,309 @@
+//
+// Copyright (c) 2022 Bjørn Fuglestad, Jaersense AS (bjorn@jaersense.no)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/bjorn-jaes/jay
+//
+
+#ifndef JAY_STAGE_HISTOGRAM_H
+#define JAY_STAGE_HISTOGRAM_H
+
+#pragma once
+
+// C++
+#include <algorithm>//std::min, std::max
+#include <array>//std::array
+#include <atomic>//std::atomic
+#include <chrono>//std::chrono::nanoseconds, std::chrono::steady_clock
+#include <cmath>//std::ceil
+#include <cstdint>//std::uint64_t
+
+namespace jay {
+
+/**
+ * @brief Log-linear (HDR style) latency histogram
+ *
+ * Values bellow 64 ns are counted exactly, above that each power of two is
+ * split into 32 buckets, giving a relative error of at most ~3%.
+ * Values are clamped to 2^40 ns (~18 min).
+ * @note Recording is wait free but only one thread may record into a histogram,
+ * reading and merging can be done from any thread.
+ */
+class latency_histogram
+{
+public:
+  static constexpr std::uint64_t sub_bucket_bits = 5;
+  static constexpr std::uint64_t sub_bucket_count = 1ULL << sub_bucket_bits;
+  static constexpr std::uint64_t max_magnitude = 40;
+  static constexpr std::uint64_t max_value = (1ULL << max_magnitude) - 1;
+  static constexpr std::size_t bucket_count = 2 * sub_bucket_count
+                                              + (max_magnitude - sub_bucket_bits - 1) * sub_bucket_count;
+
+  /**
+   * @brief Summary of the recorded values
+   */
+  struct summary
+  {
+    std::uint64_t count{};
+    std::chrono::nanoseconds p50{};
+    std::chrono::nanoseconds p99{};
+    std::chrono::nanoseconds max{};
+  };
+
+  /**
+   * @brief Record a value
+   * @param value in nanoseconds
+   */
+  void record(std::uint64_t value) noexcept
+  {
+    auto &bucket = buckets_[index(value)];
+    bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    if (value > max_.load(std::memory_order_relaxed)) { max_.store(value, std::memory_order_relaxed); }
+  }
+
+  /**
+   * @brief Record a latency
+   * @param latency to record, negative latencies are recorded as 0
+   */
+  void record(std::chrono::nanoseconds latency) noexcept
+  {
+    record(static_cast<std::uint64_t>(std::max<std::int64_t>(latency.count(), 0)));
+  }
+
+  /**
+   * @brief Add the counts of another histogram to this one
+   * @param other histogram to add
+   */
+  void merge(const latency_histogram &other) noexcept
+  {
+    for (std::size_t i = 0; i < bucket_count; i++) {
+      if (auto count = other.buckets_[i].load(std::memory_order_relaxed); count > 0) {
+        buckets_[i].fetch_add(count, std::memory_order_relaxed);
+      }
+    }
+    auto other_max = other.max_.load(std::memory_order_relaxed);
+    if (other_max > max_.load(std::memory_order_relaxed)) { max_.store(other_max, std::memory_order_relaxed); }
+  }
+
+  /**
+   * @brief Clear all recorded values
+   */
+  void reset() noexcept
+  {
+    for (auto &bucket : buckets_) { bucket.store(0, std::memory_order_relaxed); }
+    max_.store(0, std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Get the number of recorded values
+   * @return count
+   */
+  std::uint64_t count() const noexcept
+  {
+    std::uint64_t total{ 0 };
+    for (auto &bucket : buckets_) { total += bucket.load(std::memory_order_relaxed); }
+    return total;
+  }
+
+  /**
+   * @brief Get the largest recorded value
+   * @return max value in nanoseconds
+   */
+  std::uint64_t max() const noexcept { return max_.load(std::memory_order_relaxed); }
+
+  /**
+   * @brief Get the value at a percentile
+   * @param percentile between 0.0 and 100.0
+   * @return highest value equivalent to the value at the percentile, is never larger than max
+   */
+  std::uint64_t percentile(double percentile) const noexcept
+  {
+    auto total = count();
+    if (total == 0) { return 0; }
+
+    auto rank =
+      static_cast<std::uint64_t>(std::ceil(std::clamp(percentile, 0.0, 100.0) / 100.0 * static_cast<double>(total)));
+    rank = std::max<std::uint64_t>(rank, 1);
+
+    std::uint64_t seen{ 0 };
+    for (std::size_t i = 0; i < bucket_count; i++) {
+      seen += buckets_[i].load(std::memory_order_relaxed);
+      if (seen >= rank) { return std::min(highest_equivalent(i), max()); }
+    }
+    return max();
+  }
+
+  /**
+   * @brief Summarize the recorded values
+   * @return count, p50, p99 and max
+   */
+  summary summarize() const noexcept
+  {
+    return summary{ count(),
+      std::chrono::nanoseconds{ percentile(50.0) },
+      std::chrono::nanoseconds{ percentile(99.0) },
+      std::chrono::nanoseconds{ max() } };
+  }
+
+  /**
+   * @brief Get the bucket a value is counted in
+   * @param value to get bucket for
+   * @return bucket index
+   */
+  static constexpr std::size_t index(std::uint64_t value) noexcept
+  {
+    value = std::min(value, max_value);
+    if (value < 2 * sub_bucket_count) { return static_cast<std::size_t>(value); }
+    auto magnitude = static_cast<std::uint64_t>(63 - __builtin_clzll(value));
+    auto shift = magnitude - sub_bucket_bits;
+    return static_cast<std::size_t>(2 * sub_bucket_count + (magnitude - sub_bucket_bits - 1) * sub_bucket_count
+                                    + ((value >> shift) - sub_bucket_count));
+  }
+
+  /**
+   * @brief Get the largest value that is counted in a bucket
+   * @param index of the bucket
+   * @return largest value
+   */
+  static constexpr std::uint64_t highest_equivalent(std::size_t index) noexcept
+  {
+    if (index < 2 * sub_bucket_count) { return index; }
+    auto octave = (index - 2 * sub_bucket_count) / sub_bucket_count;
+    auto sub_bucket = (index - 2 * sub_bucket_count) % sub_bucket_count;
+    auto shift = octave + 1;
+    return ((sub_bucket_count + sub_bucket) << shift) + (1ULL << shift) - 1;
+  }
+
+private:
+  std::array<std::atomic<std::uint64_t>, bucket_count> buckets_{};
+  std::atomic<std::uint64_t> max_{ 0 };
+};
+
+/**
+ * @brief Stages a recieved frame passes through
+ */
+enum class stage : std::uint8_t {
+  socket_read,// Kernel receive time until the frame is read from the socket, software timestamps only
+  check_address,// Checking if the connection should deliver the frame
+  network_process,// network_manager::process
+  address_event,// Posting of an address_manager event until the state machine has processed it
+  user_callback// Frame callback passed to the connection
+};
+
+constexpr std::size_t stage_count{ 5 };
+
+/**
+ * @brief Process wide per-stage latency histograms
+ *
+ * Each thread records into its own set of histograms, which are linked into
+ * a lock-free list the first time the thread records. Snapshots merge
+ * all threads without blocking the recording threads.
+ * @note Is only recorded into by the library if JAY_STAGE_HISTOGRAMS is defined,
+ * use the CMake option of the same name so that all translation units agree.
+ */
+class stage_histograms
+{
+public:
+#ifdef JAY_STAGE_HISTOGRAMS
+  static constexpr bool enabled{ true };
+#else
+  static constexpr bool enabled{ false };
+#endif
+
+  /**
+   * @brief Record a latency for a stage on the calling thread
+   * @param stage to record for
+   * @param latency of the stage
+   */
+  static void record(jay::stage stage, std::chrono::nanoseconds latency)
+  {
+    local().stages[static_cast<std::size_t>(stage)].record(latency);
+  }
+
+  /**
+   * @brief Get p50, p99 and max for each stage merged across all threads
+   * @return summary per stage, indexed by jay::stage
+   */
+  static std::array<latency_histogram::summary, stage_count> snapshot()
+  {
+    std::array<latency_histogram::summary, stage_count> summaries{};
+    for (std::size_t i = 0; i < stage_count; i++) {
+      latency_histogram merged{};
+      for (auto *node = head().load(std::memory_order_acquire); node != nullptr; node = node->next) {
+        merged.merge(node->stages[i]);
+      }
+      summaries[i] = merged.summarize();
+    }
+    return summaries;
+  }
+
+  /**
+   * @brief Clear the histograms of all threads
+   * @note values recorded while resetting might be lost
+   */
+  static void reset() noexcept
+  {
+    for (auto *node = head().load(std::memory_order_acquire); node != nullptr; node = node->next) {
+      for (auto &histogram : node->stages) { histogram.reset(); }
+    }
+  }
+
+private:
+  /**
+   * @internal
+   * @brief Histograms owned by one thread
+   * @note Nodes are never freed, so that snapshots can read them after the thread exits
+   */
+  struct thread_histograms
+  {
+    std::array<latency_histogram, stage_count> stages{};
+    thread_histograms *next{ nullptr };
+  };
+
+  static std::atomic<thread_histograms *> &head() noexcept
+  {
+    static std::atomic<thread_histograms *> head{ nullptr };
+    return head;
+  }
+
+  static thread_histograms &local()
+  {
+    thread_local thread_histograms *local = [] {
+      auto *node = new thread_histograms{};
+      node->next = head().load(std::memory_order_relaxed);
+      while (!head().compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed)) {}
+      return node;
+    }();
+    return *local;
+  }
+};
+
+/**
+ * @brief Measures the time from construction until a stage is recorded
+ * @note Is an empty type that does nothing if JAY_STAGE_HISTOGRAMS is not defined
+ */
+class stage_timer
+{
+public:
+#ifdef JAY_STAGE_HISTOGRAMS
+  /**
+   * @brief Record the time since construction for a stage
+   * @param stage to record for
+   */
+  void record(jay::stage stage) const { stage_histograms::record(stage, std::chrono::steady_clock::now() - start_); }
+
+private:
+  std::chrono::steady_clock::time_point start_{ std::chrono::steady_clock::now() };
+#else
+  /**
+   * @brief Does nothing as stage histograms are disabled
+   */
+  void record(jay::stage) const noexcept {}
+#endif
+};
+
+}// namespace jay
+
+#endif
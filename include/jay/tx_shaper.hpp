@@ -0,0 +1,242 @@
+//
+// Copyright (c) 2022 Bjørn Fuglestad, Jaersense AS (bjorn@jaersense.no)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/bjorn-jaes/jay
+//
+
+#ifndef JAY_TX_SHAPER_H
+#define JAY_TX_SHAPER_H
+
+#pragma once
+
+// C++
+#include <algorithm>//std::min, std::max
+#include <array>//std::array
+#include <atomic>//std::atomic
+#include <chrono>//std::chrono::steady_clock
+#include <cstdint>//std::uint32_t, std::uint64_t
+#include <unordered_map>//std::unordered_map
+
+// Local
+#include "bus_load.hpp"// jay::frame_bits
+#include "frame.hpp"// jay::frame
+
+namespace jay {
+
+/**
+ * @brief Token bucket shaping of transmitted frames per priority and per PGN
+ *
+ * Every priority and PGN can be given a rate in bits/s, measured with the exact
+ * length of the frame on the bus. A frame conforms if the bucket of its priority
+ * and the bucket of its PGN both hold enough bits, and is then charged to both.
+ * Frames that do not conform should be deferred by the caller and sent once wait
+ * has passed, the time they were deferred is recorded with record_deferral.
+ * @note Is not thread safe, except for get_stats which can be called from any thread
+ */
+class tx_shaper
+{
+public:
+  using clock = std::chrono::steady_clock;
+
+  /// Bits of the longest frame, buckets always hold at least this many so every frame can conform
+  static constexpr std::uint32_t max_frame_bits{ 160 };
+
+  /**
+   * @brief Time frames of a priority were deferred
+   */
+  struct deferral
+  {
+    std::uint64_t count{}; /**< Frames deferred */
+    std::chrono::nanoseconds total{}; /**< Sum of deferral for all frames */
+    std::chrono::nanoseconds max{}; /**< Longest deferral */
+
+    /**
+     * @brief Get the mean deferral
+     * @return mean deferral, or zero if no frames were deferred
+     */
+    std::chrono::nanoseconds mean() const noexcept
+    {
+      return count > 0 ? total / static_cast<std::int64_t>(count) : std::chrono::nanoseconds{};
+    }
+  };
+
+  /**
+   * @brief Snapshot of shaper statistics
+   */
+  struct stats
+  {
+    std::uint64_t conforming{}; /**< Frames that conformed when first offered */
+    std::array<deferral, 8> priority{}; /**< Deferred frames per priority */
+  };
+
+  /**
+   * @brief Limit the rate of a priority
+   * @param priority to limit, 0 - 7
+   * @param bits_per_second rate, zero for no limit
+   * @param burst_bits that can be sent back to back, at least max_frame_bits
+   */
+  void limit_priority(priority_t priority, std::uint32_t bits_per_second, std::uint32_t burst_bits = 8 * max_frame_bits)
+  {
+    priorities_[std::min<priority_t>(priority, 7)] = bucket{ bits_per_second, burst_bits };
+  }
+
+  /**
+   * @brief Limit the rate of a PGN
+   * @param pgn to limit
+   * @param bits_per_second rate, zero for no limit
+   * @param burst_bits that can be sent back to back, at least max_frame_bits
+   */
+  void limit_pgn(pgn_t pgn, std::uint32_t bits_per_second, std::uint32_t burst_bits = 8 * max_frame_bits)
+  {
+    if (bits_per_second == 0) {
+      pgns_.erase(pgn);
+      return;
+    }
+    pgns_[pgn] = bucket{ bits_per_second, burst_bits };
+  }
+
+  /**
+   * @brief Charge a frame if it conforms to the limits of its priority and PGN
+   * @param frame to send
+   * @param now time the frame would be sent
+   * @return true if the frame can be sent, false if it must be deferred
+   */
+  bool try_send(const jay::frame &frame, clock::time_point now = clock::now())
+  {
+    auto bits = frame_bits(frame);
+    auto &priority = priorities_[frame.header.priority()];
+    auto pgn = pgns_.find(frame.header.pgn());
+
+    priority.refill(now);
+    if (pgn != pgns_.end()) { pgn->second.refill(now); }
+    if (priority.tokens < bits || (pgn != pgns_.end() && pgn->second.tokens < bits)) { return false; }
+
+    priority.take(bits);
+    if (pgn != pgns_.end()) { pgn->second.take(bits); }
+    return true;
+  }
+
+  /**
+   * @brief Get the time until a frame conforms
+   * @param frame to send
+   * @param now current time
+   * @return time to wait before try_send can succeed, zero if it can be sent now
+   */
+  clock::duration wait(const jay::frame &frame, clock::time_point now = clock::now()) const
+  {
+    auto bits = frame_bits(frame);
+    auto result = priorities_[frame.header.priority()].wait(bits, now);
+    if (auto pgn = pgns_.find(frame.header.pgn()); pgn != pgns_.end()) {
+      result = std::max(result, pgn->second.wait(bits, now));
+    }
+    return result;
+  }
+
+  /**
+   * @brief Count a frame that conformed when first offered
+   */
+  void record_conforming() noexcept { conforming_.fetch_add(1, std::memory_order_relaxed); }
+
+  /**
+   * @brief Record the time a frame was deferred before it was sent
+   * @param priority of the frame
+   * @param latency from the frame was first offered until it conformed
+   */
+  void record_deferral(priority_t priority, clock::duration latency) noexcept
+  {
+    auto &record = deferrals_[std::min<priority_t>(priority, 7)];
+    auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count();
+    record.count.fetch_add(1, std::memory_order_relaxed);
+    record.total.fetch_add(nanoseconds, std::memory_order_relaxed);
+    if (nanoseconds > record.max.load(std::memory_order_relaxed)) {
+      record.max.store(nanoseconds, std::memory_order_relaxed);
+    }
+  }
+
+  /**
+   * @brief Get statistics
+   * @return snapshot of the current statistics
+   */
+  stats get_stats() const noexcept
+  {
+    stats result{ conforming_.load(std::memory_order_relaxed) };
+    for (std::size_t i = 0; i < deferrals_.size(); i++) {
+      result.priority[i] = deferral{ deferrals_[i].count.load(std::memory_order_relaxed),
+        std::chrono::nanoseconds{ deferrals_[i].total.load(std::memory_order_relaxed) },
+        std::chrono::nanoseconds{ deferrals_[i].max.load(std::memory_order_relaxed) } };
+    }
+    return result;
+  }
+
+private:
+  /**
+   * @internal
+   * @brief Token bucket in bits, a rate of zero never limits
+   */
+  struct bucket
+  {
+    bucket() = default;
+    bucket(std::uint32_t bits_per_second, std::uint32_t burst_bits)
+      : rate(bits_per_second), burst(std::max(burst_bits, max_frame_bits)), tokens(burst)
+    {}
+
+    std::uint32_t rate{ 0 };
+    double burst{ 0.0 };
+    double tokens{ max_frame_bits };
+    clock::time_point updated{};
+
+    void refill(clock::time_point now) noexcept
+    {
+      if (rate == 0) {
+        tokens = max_frame_bits;
+        return;
+      }
+      if (now > updated) {
+        tokens = std::min(burst, tokens + available(now));
+        updated = now;
+      }
+    }
+
+    void take(std::uint32_t bits) noexcept
+    {
+      if (rate != 0) { tokens -= bits; }
+    }
+
+    double available(clock::time_point now) const noexcept
+    {
+      return updated == clock::time_point{} ? burst : std::chrono::duration<double>(now - updated).count() * rate;
+    }
+
+    clock::duration wait(std::uint32_t bits, clock::time_point now) const noexcept
+    {
+      if (rate == 0) { return clock::duration::zero(); }
+      auto missing = bits - std::min(burst, tokens + (now > updated ? available(now) : 0.0));
+      if (missing <= 0.0) { return clock::duration::zero(); }
+      return std::chrono::ceil<clock::duration>(std::chrono::duration<double>(missing / rate));
+    }
+  };
+
+  /**
+   * @internal
+   * @brief Deferral counters of a priority
+   */
+  struct deferral_counter
+  {
+    std::atomic<std::uint64_t> count{ 0 };
+    std::atomic<std::int64_t> total{ 0 };
+    std::atomic<std::int64_t> max{ 0 };
+  };
+
+  std::array<bucket, 8> priorities_{};
+  std::unordered_map<pgn_t, bucket> pgns_{};
+
+  std::atomic<std::uint64_t> conforming_{ 0 };
+  std::array<deferral_counter, 8> deferrals_{};
+};
+
+}// namespace jay
+
+#endif
@@ -0,0 +1,78 @@
+//
+// Copyright (c) 2022 Bjørn Fuglestad, Jaersense AS (bjorn@jaersense.no)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/bjorn-jaes/jay
+//
+
+#include <gtest/gtest.h>
+
+#include "../include/jay/bus_load.hpp"
+
+// C++
+#include <chrono>
+
+namespace {
+
+jay::frame make_frame(std::uint32_t id, jay::payload payload, std::uint8_t length = 8)
+{
+  return jay::frame{ jay::frame_header{ id, length }, payload };
+}
+
+}// namespace
+
+TEST(Jay_Bus_Load_Test, Jay_Frame_Bits_Test)
+{
+  // Alternating payload bits are never stuffed, the identifier needs 3 stuff bits
+  ASSERT_EQ(jay::frame_bits(make_frame(0x0C'F0'04'00, { 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55 })), 134U);
+  ASSERT_EQ(jay::frame_bits(make_frame(0x18'FE'F1'00, {})), 147U);
+  ASSERT_EQ(jay::frame_bits(make_frame(0x18'FE'F1'FE, { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF })), 145U);
+  ASSERT_EQ(jay::frame_bits(make_frame(0x18'EA'FF'80, { 0xDA, 0xFE, 0x00 }, 3)), 96U);
+
+  // Is usable at compile time
+  static_assert(jay::frame_bits(jay::frame{}) >= 67);
+}
+
+TEST(Jay_Bus_Load_Test, Jay_Bus_Load_Usage_Test)
+{
+  using namespace std::chrono_literals;
+
+  jay::bus_load_monitor monitor{ 250000, 1s };
+  auto frame = make_frame(0x18'FE'F1'00, {});
+  auto start = jay::bus_load_monitor::clock::time_point{ 100s };
+
+  // 1000 frames per second from 0x00, 100 frames per second of another PGN from 0x21
+  for (int i = 0; i < 1000; i++) { monitor.record(frame, start + i * 1ms); }
+  for (int i = 0; i < 100; i++) { monitor.record(make_frame(0x0C'F0'04'21, {}), start + i * 10ms); }
+
+  auto now = start + 999ms;
+  auto usage = monitor.get_usage(now);
+  ASSERT_EQ(usage.frames, 1100U);
+  ASSERT_NEAR(usage.frames_per_second, 1100.0, 5.0);
+
+  auto source = monitor.get_source_usage(0x00, now);
+  ASSERT_EQ(source.frames, 1000U);
+  ASSERT_EQ(source.bits, 147000U);
+  ASSERT_NEAR(source.load, 100.0 * 147000.0 / 250000.0, 0.5);
+
+  auto sources = monitor.top_sources(5, now);
+  ASSERT_EQ(sources.size(), 2U);
+  ASSERT_EQ(sources[0].id, 0x00U);
+  ASSERT_EQ(sources[1].id, 0x21U);
+
+  auto pgns = monitor.top_pgns(1, now);
+  ASSERT_EQ(pgns.size(), 1U);
+  ASSERT_EQ(pgns[0].id, 0xFEF1U);
+  ASSERT_EQ(pgns[0].frames, 1000U);
+
+  // Buckets older than the window are no longer counted, 600 - 999 ms is left at 1500 ms
+  ASSERT_EQ(monitor.get_usage(start + 1500ms).frames, 440U);
+  ASSERT_EQ(monitor.get_usage(start + 5s).frames, 0U);
+
+  // Old buckets are reused
+  monitor.record(frame, start + 5s);
+  ASSERT_EQ(monitor.get_usage(start + 5s).frames, 1U);
+  ASSERT_EQ(monitor.pgn_overflow(), 0U);
+}
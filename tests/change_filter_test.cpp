@@ -0,0 +1,115 @@
+//
+// Copyright (c) 2022 Bjørn Fuglestad, Jaersense AS (bjorn@jaersense.no)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/bjorn-jaes/jay
+//
+
+#include <gtest/gtest.h>
+
+#include "../include/jay/change_filter.hpp"
+
+namespace {
+
+jay::frame make_frame(pgn_t pgn, std::uint8_t source_address, std::uint64_t word)
+{
+  return jay::frame{ jay::frame_header{ 6, pgn, source_address, 8 }, jay::to_payload(word) };
+}
+
+}// namespace
+
+TEST(Jay_Change_Filter_Test, Jay_Change_Filter_Suppress_Test)
+{
+  jay::change_filter filter{ std::chrono::seconds(1) };
+  jay::change_filter::clock::time_point now{};
+
+  // First frame of every PGN and source address is delivered
+  ASSERT_TRUE(filter.pass(make_frame(0xF004, 0x00, 1), now));
+  ASSERT_TRUE(filter.pass(make_frame(0xF004, 0x01, 1), now));
+  ASSERT_TRUE(filter.pass(make_frame(0xFEF1, 0x00, 1), now));
+  ASSERT_EQ(filter.size(), 3U);
+
+  ASSERT_FALSE(filter.pass(make_frame(0xF004, 0x00, 1), now));
+  ASSERT_FALSE(filter.pass(make_frame(0xF004, 0x01, 1), now));
+  ASSERT_TRUE(filter.pass(make_frame(0xF004, 0x00, 2), now));
+  ASSERT_FALSE(filter.pass(make_frame(0xF004, 0x00, 2), now));
+
+  // Length change is a change
+  auto frame = make_frame(0xF004, 0x00, 2);
+  frame.header.payload_length(4);
+  ASSERT_TRUE(filter.pass(frame, now));
+
+  auto stats = filter.get_stats();
+  ASSERT_EQ(stats.frames, 8U);
+  ASSERT_EQ(stats.changed, 5U);
+  ASSERT_EQ(stats.suppressed, 3U);
+  ASSERT_EQ(stats.keep_alive, 0U);
+  ASSERT_DOUBLE_EQ(stats.suppression_rate(), 3.0 / 8.0);
+
+  filter.clear();
+  ASSERT_EQ(filter.size(), 0U);
+  ASSERT_TRUE(filter.pass(make_frame(0xF004, 0x01, 1), now));
+}
+
+TEST(Jay_Change_Filter_Test, Jay_Change_Filter_Keep_Alive_Test)
+{
+  jay::change_filter filter{ std::chrono::milliseconds(100) };
+  jay::change_filter::clock::time_point now{};
+
+  ASSERT_TRUE(filter.pass(make_frame(0xF004, 0x00, 1), now));
+  ASSERT_FALSE(filter.pass(make_frame(0xF004, 0x00, 1), now + std::chrono::milliseconds(99)));
+  ASSERT_TRUE(filter.pass(make_frame(0xF004, 0x00, 1), now + std::chrono::milliseconds(100)));
+  ASSERT_FALSE(filter.pass(make_frame(0xF004, 0x00, 1), now + std::chrono::milliseconds(150)));
+  ASSERT_EQ(filter.get_stats().keep_alive, 1U);
+
+  // Keep-alive is disabled with zero
+  jay::change_filter no_keep_alive{ jay::change_filter::clock::duration::zero() };
+  ASSERT_TRUE(no_keep_alive.pass(make_frame(0xF004, 0x00, 1), now));
+  ASSERT_FALSE(no_keep_alive.pass(make_frame(0xF004, 0x00, 1), now + std::chrono::hours(1)));
+}
+
+TEST(Jay_Change_Filter_Test, Jay_Change_Filter_Ignore_Test)
+{
+  jay::change_filter filter{};
+  jay::change_filter::clock::time_point now{};
+
+  ASSERT_TRUE(filter.pass(make_frame(0xFF10, 0x00, 0x0000'0000'0000'1001), now));
+  ASSERT_TRUE(filter.pass(make_frame(0xFF10, 0x00, 0x0000'0000'0000'1002), now));
+
+  // Ignoring the counter in byte 0 applies to cached entries as well
+  filter.ignore(0xFF10, 0xFF);
+  ASSERT_FALSE(filter.pass(make_frame(0xFF10, 0x00, 0x0000'0000'0000'1003), now));
+  ASSERT_TRUE(filter.pass(make_frame(0xFF10, 0x00, 0x0000'0000'0000'2003), now));
+  ASSERT_TRUE(filter.pass(make_frame(0xFF10, 0x01, 0x0000'0000'0000'2003), now));
+  ASSERT_FALSE(filter.pass(make_frame(0xFF10, 0x01, 0x0000'0000'0000'2004), now));
+
+  // Other PGNs are not affected
+  ASSERT_TRUE(filter.pass(make_frame(0xFF11, 0x00, 0x0000'0000'0000'1001), now));
+  ASSERT_TRUE(filter.pass(make_frame(0xFF11, 0x00, 0x0000'0000'0000'1002), now));
+}
+
+TEST(Jay_Change_Filter_Test, Jay_Change_Filter_Peer_To_Peer_Test)
+{
+  jay::change_filter filter{};
+  jay::change_filter::clock::time_point now{};
+
+  // Repeated requests are let through, both global and to a specific address
+  auto global_request = jay::frame::make_request(J1939_PGN_ADDRESS_CLAIMED, J1939_NO_ADDR, 0x10);
+  auto request = jay::frame::make_request(J1939_PGN_ADDRESS_CLAIMED, 0x20, 0x10);
+  ASSERT_TRUE(filter.pass(global_request, now));
+  ASSERT_TRUE(filter.pass(global_request, now));
+  ASSERT_TRUE(filter.pass(request, now));
+  ASSERT_TRUE(filter.pass(request, now));
+
+  // As are other peer-to-peer frames
+  ASSERT_TRUE(filter.pass(make_frame(0xE800, 0x10, 1), now));
+  ASSERT_TRUE(filter.pass(make_frame(0xE800, 0x10, 1), now));
+  ASSERT_EQ(filter.size(), 0U);
+
+  auto stats = filter.get_stats();
+  ASSERT_EQ(stats.frames, 6U);
+  ASSERT_EQ(stats.peer_to_peer, 6U);
+  ASSERT_EQ(stats.suppressed, 0U);
+}
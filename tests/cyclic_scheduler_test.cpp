@@ -0,0 +1,137 @@
+//
+// Copyright (c) 2022 Bjørn Fuglestad, Jaersense AS (bjorn@jaersense.no)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/bjorn-jaes/jay
+//
+
+#include <gtest/gtest.h>
+
+#include "../include/jay/cyclic_scheduler.hpp"
+
+// C++
+#include <chrono>
+#include <set>
+#include <vector>
+
+class CyclicSchedulerTest : public testing::Test
+{
+protected:
+  CyclicSchedulerTest()
+  {
+    j1939_network.insert(local_name, 0x80);
+    scheduler.set_callbacks(jay::cyclic_scheduler::callbacks{
+      [this](const std::vector<jay::frame> &frames) -> void { batches.push_back(frames); },
+      [](auto, auto) -> void {} });
+  }
+
+  static jay::frame make_cyclic(pgn_t pgn)
+  {
+    return jay::frame{ jay::frame_header{ 6, pgn, J1939_NO_ADDR, 8 }, {} };
+  }
+
+public:
+  jay::name local_name{ 0xA00U };
+  boost::asio::io_context context{};
+  jay::network j1939_network{ "vcan0" };
+  jay::cyclic_scheduler scheduler{ context, local_name, j1939_network };
+
+  std::vector<std::vector<jay::frame>> batches{};
+};
+
+TEST_F(CyclicSchedulerTest, Jay_Cyclic_Scheduler_Phase_Test)
+{
+  using namespace std::chrono_literals;
+
+  // Periods of 10, 20, 100 and 1000 ms fit without sharing a tick
+  std::vector<jay::cyclic_scheduler::handle> handles{};
+  for (pgn_t pgn = 0xF000; pgn < 0xF004; pgn++) { handles.push_back(scheduler.add(make_cyclic(pgn), 10ms)); }
+  for (pgn_t pgn = 0xF010; pgn < 0xF014; pgn++) { handles.push_back(scheduler.add(make_cyclic(pgn), 20ms)); }
+  handles.push_back(scheduler.add(make_cyclic(0xFEF1), 100ms));
+  handles.push_back(scheduler.add(make_cyclic(0xFEE5), 1000ms));
+  scheduler.start();
+
+  std::set<std::int64_t> ticks{};
+  for (auto handle : handles) {
+    auto phase = scheduler.get_phase(handle) / jay::cyclic_scheduler::resolution;
+    ASSERT_LT(phase, 10);
+    for (auto tick = phase; tick < 1000; tick += 10) {
+      if (handle >= 4 && handle < 8 && ((tick - phase) / 10) % 2 == 1) { continue; }
+      if (handle == 8 && (tick - phase) % 100 != 0) { continue; }
+      if (handle == 9 && tick != phase) { continue; }
+      ASSERT_TRUE(ticks.insert(tick).second) << "Handle " << handle << " shares tick " << tick;
+    }
+  }
+
+  ASSERT_THROW(scheduler.add(make_cyclic(0xF100), 10ms), std::invalid_argument);
+}
+
+TEST_F(CyclicSchedulerTest, Jay_Cyclic_Scheduler_Send_Test)
+{
+  using namespace std::chrono_literals;
+
+  ASSERT_THROW(scheduler.add(make_cyclic(0xF000), 100us), std::invalid_argument);
+
+  auto handle = scheduler.add(make_cyclic(0xF004), 10ms);
+  scheduler.start();
+  scheduler.update(handle, { 1, 2, 3, 4, 5, 6, 7, 8 });
+  context.run_for(95ms);
+
+  // Deadlines at 0, 10, ... 90 ms, a loaded machine may skip some of them
+  auto stats = scheduler.get_stats();
+  ASSERT_GE(batches.size(), 5U);
+  ASSERT_LE(stats.ticks + stats.skipped, 10U);
+  for (auto &batch : batches) {
+    ASSERT_EQ(batch.size(), 1U);
+    ASSERT_EQ(batch[0].header.pgn(), 0xF004U);
+    ASSERT_EQ(batch[0].header.source_adderess(), 0x80);
+    ASSERT_EQ(batch[0].payload[7], 8);
+  }
+
+  ASSERT_EQ(stats.ticks, batches.size());
+  ASSERT_EQ(stats.frames, batches.size());
+  ASSERT_EQ(stats.no_address, 0U);
+}
+
+TEST_F(CyclicSchedulerTest, Jay_Cyclic_Scheduler_Restart_Test)
+{
+  using namespace std::chrono_literals;
+
+  scheduler.add(make_cyclic(0xF004), 10ms);
+  scheduler.start();
+  context.run_for(25ms);
+  ASSERT_FALSE(batches.empty());
+
+  // The context runs out of work when stopped
+  scheduler.stop();
+  context.restart();
+  context.run_for(25ms);
+  auto stopped = batches.size();
+  context.restart();
+  context.run_for(25ms);
+  ASSERT_EQ(batches.size(), stopped);
+
+  // Resumes from the time it is started again
+  scheduler.start();
+  context.restart();
+  context.run_for(25ms);
+  ASSERT_GT(batches.size(), stopped);
+}
+
+TEST_F(CyclicSchedulerTest, Jay_Cyclic_Scheduler_No_Address_Test)
+{
+  using namespace std::chrono_literals;
+
+  j1939_network.release(local_name);
+  scheduler.add(make_cyclic(0xF004), 10ms);
+  scheduler.start();
+  context.run_for(25ms);
+  ASSERT_TRUE(batches.empty());
+
+  // Deadlines at 0, 10 and 20 ms, a loaded machine may skip some of them
+  auto stats = scheduler.get_stats();
+  ASSERT_GE(stats.no_address, 1U);
+  ASSERT_LE(stats.no_address + stats.skipped, 3U);
+}
@@ -0,0 +1,97 @@
+//
+// Copyright (c) 2022 Bjørn Fuglestad, Jaersense AS (bjorn@jaersense.no)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/bjorn-jaes/jay
+//
+
+#include <gtest/gtest.h>
+
+#include "../include/jay/frame_columns.hpp"
+
+// C++
+#include <random>
+#include <vector>
+
+namespace {
+
+std::vector<jay::frame> make_frames(std::size_t count)
+{
+  std::mt19937 generator{ 1939 };
+  std::vector<jay::frame> frames(count);
+  for (auto &frame : frames) {
+    frame.header = jay::frame_header{ static_cast<std::uint32_t>(generator()), static_cast<std::uint8_t>(generator() % 9) };
+    for (auto &byte : frame.payload) { byte = static_cast<std::uint8_t>(generator()); }
+  }
+  return frames;
+}
+
+void expect_columns(const std::vector<jay::frame> &frames, const jay::frame_columns &columns)
+{
+  ASSERT_EQ(columns.size(), frames.size());
+  for (std::size_t i = 0; i < frames.size(); i++) {
+    auto &header = frames[i].header;
+    ASSERT_EQ(columns.id[i], header.id()) << i;
+    ASSERT_EQ(columns.pgn[i], header.pgn()) << i;
+    ASSERT_EQ(columns.pdu_format[i], header.pdu_format()) << i;
+    ASSERT_EQ(columns.pdu_specific[i], header.pdu_specific()) << i;
+    ASSERT_EQ(columns.source_address[i], header.source_adderess()) << i;
+    ASSERT_EQ(columns.priority[i], header.priority()) << i;
+    ASSERT_EQ(columns.length[i], header.payload_length()) << i;
+    ASSERT_EQ(columns.payload[i], jay::to_word(frames[i].payload)) << i;
+  }
+}
+
+}// namespace
+
+TEST(Jay_Frame_Columns_Test, Jay_Frame_Columns_Decode_Test)
+{
+  // Sizes around the SIMD widths so that the scalar remainder is covered
+  for (std::size_t count : { 0, 1, 3, 4, 5, 7, 8, 9, 16, 17, 1001 }) {
+    auto frames = make_frames(count);
+
+    jay::frame_columns columns{};
+    jay::decode_columns(frames.data(), frames.size(), columns);
+    expect_columns(frames, columns);
+
+    jay::frame_columns scalar{};
+    jay::decode_columns_scalar(frames.data(), frames.size(), scalar);
+    expect_columns(frames, scalar);
+  }
+}
+
+TEST(Jay_Frame_Columns_Test, Jay_Frame_Columns_Can_Frame_Test)
+{
+  auto frames = make_frames(33);
+  std::vector<can_frame> can_frames(frames.size());
+  for (std::size_t i = 0; i < frames.size(); i++) { can_frames[i] = jay::frame::to_can(frames[i]); }
+
+  // Reused columns are resized to the new batch
+  jay::frame_columns columns{};
+  jay::decode_columns(make_frames(100).data(), 100, columns);
+  jay::decode_columns(can_frames.data(), can_frames.size(), columns);
+  expect_columns(frames, columns);
+
+  jay::decode_columns_scalar(can_frames.data(), can_frames.size(), columns);
+  expect_columns(frames, columns);
+}
+
+TEST(Jay_Frame_Columns_Test, Jay_Frame_Columns_Pgn_Test)
+{
+  // PDU1 destination address is not part of the PGN, PDU2 group extension is
+  std::vector<jay::frame> frames{ jay::frame::make_address_request(0x42),
+    jay::frame{ jay::frame_header{ 3, 0xF004, 0x00, 8 }, {} },
+    jay::frame{ jay::frame_header{ 6, 0x1EF00, 0x80, 8 }, {} } };
+  frames.resize(8, frames.back());
+
+  jay::frame_columns columns{};
+  jay::decode_columns(frames.data(), frames.size(), columns);
+  ASSERT_EQ(columns.pgn[0], static_cast<pgn_t>(J1939_PGN_REQUEST));
+  ASSERT_EQ(columns.pdu_specific[0], 0x42);
+  ASSERT_EQ(columns.pgn[1], 0xF004U);
+  ASSERT_EQ(columns.pgn[2], 0x1EF00U);
+  ASSERT_EQ(columns.source_address[2], 0x80);
+  ASSERT_EQ(columns.priority[2], 6);
+}
@@ -47,6 +47,26 @@ TEST(Jay_Frame_Test, Jay_Frame_Create_Test)
   ASSERT_EQ(addr_req.payload[1], 0xEE);
   ASSERT_EQ(addr_req.payload[2], 0x00);
 
+  auto req = jay::frame::make_request(0x1FEDA, 0x21, 0x80);
+  ASSERT_TRUE(req.header.is_request());
+  ASSERT_EQ(req.header.id(), 0x18'EA'21'80);
+  ASSERT_EQ(req.header.pdu_specific(), 0x21);
+  ASSERT_EQ(req.header.source_adderess(), 0x80);
+  ASSERT_EQ(req.header.payload_length(), 3);
+  ASSERT_EQ(req.payload[0], 0xDA);
+  ASSERT_EQ(req.payload[1], 0xFE);
+  ASSERT_EQ(req.payload[2], 0x01);
+
+  auto nack = jay::frame::make_acknowledgement(jay::ACK_NEGATIVE, 0xFEDA, 0x80, 0x21);
+  ASSERT_TRUE(nack.header.is_acknowledgement());
+  ASSERT_FALSE(req.header.is_acknowledgement());
+  ASSERT_EQ(nack.header.id(), 0x18'E8'FF'21);
+  ASSERT_EQ(nack.payload[0], jay::ACK_NEGATIVE);
+  ASSERT_EQ(nack.payload[4], 0x80);
+  ASSERT_EQ(nack.payload[5], 0xDA);
+  ASSERT_EQ(nack.payload[6], 0xFE);
+  ASSERT_EQ(nack.payload[7], 0x00);
+
   /// TODO: Add static asserts regarding less then 8 size on payload for make functions
 
   auto cant_claim = jay::frame::make_cannot_claim(jay::name{ 0x00'00'00'00'00'00'00'00 });
@@ -74,6 +94,24 @@ TEST(Jay_Frame_Test, Jay_Frame_Create_Test)
   ASSERT_EQ(claim.header.payload_length(), 8);
 }
 
+TEST(Jay_Frame_Test, Jay_Frame_Constexpr_Test)
+{
+  // Archetypes are compile time constants
+  constexpr auto addr_req = jay::frame::make_address_request();
+  static_assert(addr_req.header.is_request());
+  static_assert(addr_req.header.id() == 0x18'EA'FF'FE);
+
+  constexpr auto addr_claim = jay::frame::make_address_claim(jay::name{ 0xC880808480200000UL }, 0x10);
+  static_assert(addr_claim.header.is_claim());
+  static_assert(addr_claim.header.source_adderess() == 0x10);
+  static_assert(jay::name{ addr_claim.payload } == 0xC880808480200000UL);
+
+  constexpr auto cannot_claim = jay::frame::make_cannot_claim(jay::name{ 0xC880808480200000UL });
+  static_assert(cannot_claim.header.source_adderess() == J1939_IDLE_ADDR);
+
+  ASSERT_EQ(addr_req.header.id(), 0x18'EA'FF'FE);
+}
+
 TEST(Jay_Frame_Test, Jay_Frame_Sync_Send_Test)
 {
   canary::net::io_context ctx{ 1 };
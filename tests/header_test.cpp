@@ -89,4 +89,25 @@ TEST(Jay_Header_Test, Jay_Header_Other_Tests)
   ASSERT_EQ(0xBB, header.pdu_format());
   ASSERT_EQ(destination_address, header.pdu_specific());
   ASSERT_EQ(source_address, header.source_adderess());
-}
\ No newline at end of file
+}
+
+TEST(Jay_Header_Test, Jay_Header_Constexpr_Tests)
+{
+  // Headers can be built and inspected at compile time
+  constexpr jay::frame_header header{ 7, true, 0xAF, 0xFF, 0x02, 1 };
+  static_assert(header.id() == 0x1D'AF'FF'02);
+  static_assert(header.priority() == 7);
+  static_assert(header.pgn() == 0x00'01'AF'00);
+  static_assert(!header.is_broadcast());
+
+  constexpr jay::frame_header header1{ 10, 0x0FAF0, 0x64, 5 };
+  static_assert(header1.priority() == 7, "Priority is clamped at compile time");
+  static_assert(header1.is_broadcast());
+  static_assert(header1.pgn() == 0x00'00'FA'F0);
+
+  constexpr auto header2 = jay::frame_header{}.priority(3).pdu_format(0xF0).pdu_specific(0x04).source_adderess(0xEE);
+  static_assert(header2.id() == 0x0C'F0'04'EE);
+  static_assert(jay::frame_header{ 0xFFFF'FFFF }.id() == 0x1F'FF'FF'FF, "Flags are not part of the id");
+
+  ASSERT_EQ(header2.id(), 0x0C'F0'04'EE);
+}
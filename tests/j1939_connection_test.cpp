@@ -0,0 +1,56 @@
+//
+// Copyright (c) 2022 Bjørn Fuglestad, Jaersense AS (bjorn@jaersense.no)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/bjorn-jaes/jay
+//
+
+#include <gtest/gtest.h>
+
+#include "../examples/j1939_connection.hpp"
+
+// C++
+#include <chrono>
+#include <memory>
+#include <vector>
+
+TEST(Jay_J1939_Connection_Test, Jay_J1939_Connection_Send_Latest_Deferred_Test)
+{
+  using namespace std::chrono_literals;
+
+  boost::asio::io_context context{};
+  jay::network j1939_network{ "vcan0" };
+  auto connection = std::make_shared<J1939Connection>(context, j1939_network);
+
+  std::vector<jay::frame> sent{};
+  J1939Connection::Callbacks callbacks{};
+  callbacks.on_read = [](jay::frame) {};
+  callbacks.on_send = [&sent](jay::frame frame) { sent.push_back(frame); };
+  callbacks.on_error = [](auto what, auto error) { ADD_FAILURE() << what << ": " << error.message(); };
+  connection->SetCallbacks(std::move(callbacks));
+
+  // Only the first frame fits the burst, the next conforms after 90 ms
+  J1939Connection::Options options{};
+  options.priority_rates[6] = 1470;
+  options.burst_bits = 0;
+  connection->SetOptions(std::move(options));
+  ASSERT_TRUE(connection->Open({}));
+
+  jay::frame frame{ jay::frame_header{ 0x18'FE'F1'00, 8 }, {} };
+  for (std::uint8_t i = 0; i < 10; i++) {
+    frame.payload[0] = i;
+    connection->SendLatest(frame);
+    context.poll();
+    ASSERT_EQ(connection->GetStats().frames_deferred, i == 0 ? 0U : 1U);
+  }
+  ASSERT_EQ(connection->GetStats().frames_coalesced, 8U);
+
+  // The deferred frame carries the latest value when it is released
+  context.run_for(200ms);
+  ASSERT_EQ(connection->GetStats().frames_deferred, 0U);
+  ASSERT_EQ(sent.size(), 2U);
+  ASSERT_EQ(sent[0].payload[0], 0);
+  ASSERT_EQ(sent[1].payload[0], 9);
+}
@@ -0,0 +1,70 @@
+//
+// Copyright (c) 2022 Bjørn Fuglestad, Jaersense AS (bjorn@jaersense.no)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/bjorn-jaes/jay
+//
+
+#include <gtest/gtest.h>
+
+#include "../include/jay/liveness_monitor.hpp"
+
+// C++
+#include <chrono>
+#include <vector>
+
+TEST(Jay_Liveness_Monitor_Test, Jay_Liveness_Monitor_Lost_Test)
+{
+  using namespace std::chrono_literals;
+
+  boost::asio::io_context context{};
+  jay::network j1939_network{ "vcan0" };
+  j1939_network.insert(jay::name{ 0xA00U }, 0x21);
+  j1939_network.insert(jay::name{ 0xB00U }, 0x22);
+
+  std::vector<std::uint8_t> lost{};
+  jay::liveness_monitor monitor{ context,
+    j1939_network,
+    jay::liveness_monitor::callbacks{
+      [&lost](jay::name, std::uint8_t address) { lost.push_back(address); }, [](auto, auto) -> void {} },
+    40ms };
+  monitor.start();
+
+  // 0x21 keeps sending, 0x22 is silent
+  jay::frame frame{ jay::frame_header{ 6, 0xFEF1, 0x21, 8 }, {} };
+  for (int i = 0; i < 8; i++) {
+    monitor.process(frame);
+    context.run_for(10ms);
+  }
+
+  ASSERT_EQ(lost.size(), 1U);
+  ASSERT_EQ(lost[0], 0x22);
+  ASSERT_EQ(monitor.lost_count(), 1U);
+  ASSERT_EQ(j1939_network.get_address(jay::name{ 0xA00U }), 0x21);
+
+  monitor.stop();
+  context.run_for(100ms);
+  ASSERT_EQ(lost.size(), 1U);
+}
+
+TEST(Jay_Liveness_Monitor_Test, Jay_Liveness_Monitor_Protect_Test)
+{
+  using namespace std::chrono_literals;
+
+  boost::asio::io_context context{};
+  jay::network j1939_network{ "vcan0" };
+  j1939_network.insert(jay::name{ 0xA00U }, 0x21);
+  j1939_network.insert(jay::name{ 0xB00U }, 0x22);
+
+  // The local controller is never read back from the bus, it keeps its address while silent
+  jay::liveness_monitor monitor{ context, j1939_network, 40ms };
+  monitor.protect(jay::name{ 0xA00U });
+  monitor.start();
+  context.run_for(100ms);
+
+  ASSERT_EQ(monitor.lost_count(), 1U);
+  ASSERT_EQ(j1939_network.get_address(jay::name{ 0xA00U }), 0x21);
+  ASSERT_TRUE(j1939_network.available(0x22));
+}
@@ -82,4 +82,22 @@ TEST(Jay_Name_Test, Jay_Name_Payload_Tests)
 
   jay::name name2{ array };
   ASSERT_EQ(name1, name2);
-}
\ No newline at end of file
+}
+
+TEST(Jay_Name_Test, Jay_Name_Constexpr_Tests)
+{
+  // Names can be built and inspected at compile time
+  constexpr jay::name name{ 0x1FFFFF, 0x7FF, 0x7, 0x1F, 0xFF, 0x7F, 0xF, 0x7, 0x1 };
+  static_assert(name == 0xFFFE'FFFF'FFFF'FFFFUL);
+  static_assert(name.function() == 0xFF);
+
+  constexpr auto name1 = jay::name{}.function(0x80).industry_group(0x4).self_config_address(1);
+  static_assert(name1.function() == 0x80);
+  static_assert(name1.industry_group() == 0x4);
+
+  constexpr std::array<std::uint8_t, 8> payload = jay::name{ 0xC880808480200000UL };
+  static_assert(payload[7] == 0xC8U);
+  static_assert(jay::name{ payload } == 0xC880808480200000UL);
+
+  ASSERT_EQ(name1.function(), 0x80);
+}
@@ -11,6 +11,12 @@
 
 #include "../include/jay/network.hpp"
 
+// C++
+#include <array>
+#include <chrono>
+#include <utility>
+#include <vector>
+
 TEST(Jay_Network_Test, Jay_Network_Insert_Test)
 {
   std::string interface_name{ "vcan0" };
@@ -145,4 +151,186 @@ TEST(Jay_Network_Test, Jay_Network_Search_Test)
   // Claim first address
   ASSERT_EQ(j1939_network.find_address(0, 0, true), 0);
   ASSERT_EQ(j1939_network.find_address(controller, 0, true), address + 1);
-}
\ No newline at end of file
+}
+
+TEST(Jay_Network_Test, Jay_Network_Liveness_Test)
+{
+  using namespace std::chrono_literals;
+
+  jay::network j1939_network{ "vcan0" };
+  ASSERT_FALSE(j1939_network.last_seen(0x21).has_value());
+
+  auto start = jay::network::clock::now();
+  j1939_network.insert(jay::name{ 0xA00U }, 0x21);
+  j1939_network.insert(jay::name{ 0xB00U }, 0x22);
+  j1939_network.seen(0x21, start + 1s);
+  j1939_network.seen(0x21, start + 2s);
+  ASSERT_EQ(j1939_network.last_seen(0x21), start + 2s);
+  ASSERT_EQ(j1939_network.frame_count(0x21), 3U);
+
+  // Only 0x22 has been silent for 3 s, it keeps its name but loses its address
+  std::vector<std::pair<jay::name, std::uint8_t>> lost{};
+  auto on_lost = [&lost](jay::name name, std::uint8_t address) { lost.push_back({ name, address }); };
+  ASSERT_EQ(j1939_network.release_silent(3s, on_lost, start + 4s), 1U);
+  ASSERT_EQ(lost.size(), 1U);
+  ASSERT_EQ(lost[0].first, jay::name{ 0xB00U });
+  ASSERT_EQ(lost[0].second, 0x22);
+  ASSERT_TRUE(j1939_network.available(0x22));
+  ASSERT_TRUE(j1939_network.in_network(jay::name{ 0xB00U }));
+  ASSERT_EQ(j1939_network.get_address(jay::name{ 0xA00U }), 0x21);
+
+  ASSERT_EQ(j1939_network.release_silent(3s, on_lost, start + 4s), 0U);
+
+  // Local controllers are never released
+  ASSERT_EQ(j1939_network.release_silent(3s, on_lost, { jay::name{ 0xA00U } }, start + 6s), 0U);
+  ASSERT_EQ(j1939_network.get_address(jay::name{ 0xA00U }), 0x21);
+
+  ASSERT_EQ(j1939_network.release_silent(3s, on_lost, start + 6s), 1U);
+  ASSERT_EQ(j1939_network.address_count(), 0U);
+}
+
+TEST(Jay_Network_Test, Jay_Network_Idle_Capacity_Test)
+{
+  using namespace std::chrono_literals;
+
+  jay::network j1939_network{ "vcan0", 3 };
+  j1939_network.insert(jay::name{ 1U }, J1939_IDLE_ADDR);
+  j1939_network.insert(jay::name{ 2U }, J1939_IDLE_ADDR);
+  j1939_network.insert(jay::name{ 3U }, J1939_IDLE_ADDR);
+
+  // Seen again, so 2 is the least recently idle
+  ASSERT_FALSE(j1939_network.insert(jay::name{ 1U }, J1939_IDLE_ADDR));
+
+  // Names with an address do not count against the capacity
+  j1939_network.insert(jay::name{ 10U }, 0x10);
+  j1939_network.insert(jay::name{ 4U }, J1939_IDLE_ADDR);
+  ASSERT_EQ(j1939_network.name_count(), 4U);
+  ASSERT_FALSE(j1939_network.in_network(jay::name{ 2U }));
+  ASSERT_TRUE(j1939_network.in_network(jay::name{ 1U }));
+
+  // Claiming an address removes a name from the idle order, releasing it adds it back
+  ASSERT_TRUE(j1939_network.insert(jay::name{ 3U }, 0x11));
+  j1939_network.insert(jay::name{ 5U }, J1939_IDLE_ADDR);
+  ASSERT_TRUE(j1939_network.in_network(jay::name{ 1U }));
+  j1939_network.release(jay::name{ 3U });
+  ASSERT_FALSE(j1939_network.in_network(jay::name{ 1U }));
+  ASSERT_EQ(j1939_network.get_address(jay::name{ 3U }), J1939_IDLE_ADDR);
+
+  auto stats = j1939_network.get_memory_stats();
+  ASSERT_EQ(stats.names, 4U);
+  ASSERT_EQ(stats.addresses, 1U);
+  ASSERT_EQ(stats.idle_names, 3U);
+  ASSERT_EQ(stats.idle_capacity, 3U);
+  ASSERT_EQ(stats.evicted, 2U);
+  ASSERT_GT(stats.bytes, 0U);
+
+  // Only idle names expire
+  ASSERT_EQ(j1939_network.expire_idle(1h), 0U);
+  ASSERT_EQ(j1939_network.expire_idle(0s, jay::network::clock::now() + 1s), 3U);
+  ASSERT_EQ(j1939_network.name_count(), 1U);
+  ASSERT_EQ(j1939_network.get_memory_stats().expired, 3U);
+
+  j1939_network.insert(jay::name{ 6U }, J1939_IDLE_ADDR);
+  j1939_network.set_idle_capacity(0);
+  ASSERT_FALSE(j1939_network.in_network(jay::name{ 6U }));
+  ASSERT_EQ(j1939_network.get_address(jay::name{ 10U }), 0x10);
+}
+
+TEST(Jay_Network_Test, Jay_Network_Idle_Capacity_Move_Test)
+{
+  jay::network j1939_network{ "vcan0", 1 };
+
+  // Moving to another address frees the previous one
+  ASSERT_TRUE(j1939_network.insert(jay::name{ 5U }, 0x10));
+  ASSERT_TRUE(j1939_network.insert(jay::name{ 5U }, 0x11));
+  ASSERT_FALSE(j1939_network.get_name(0x10));
+  ASSERT_EQ(j1939_network.get_name(0x11), jay::name{ 5U });
+  ASSERT_EQ(j1939_network.address_count(), 1U);
+
+  // Losing a claim for another address also frees the previous one
+  ASSERT_TRUE(j1939_network.insert(jay::name{ 1U }, 0x12));
+  ASSERT_TRUE(j1939_network.insert(jay::name{ 5U }, 0x12));
+  ASSERT_EQ(j1939_network.get_address(jay::name{ 5U }), J1939_IDLE_ADDR);
+  ASSERT_FALSE(j1939_network.get_name(0x11));
+
+  // An evicted idle name is not left behind at its previous address
+  ASSERT_TRUE(j1939_network.insert(jay::name{ 6U }, J1939_IDLE_ADDR));
+  ASSERT_FALSE(j1939_network.in_network(jay::name{ 5U }));
+  ASSERT_FALSE(j1939_network.get_name(0x11));
+  ASSERT_EQ(j1939_network.address_count(), 1U);
+  ASSERT_EQ(j1939_network.get_name(0x12), jay::name{ 1U });
+}
+
+TEST(Jay_Network_Test, Jay_Network_Find_Names_Test)
+{
+  using field = jay::network::name_field;
+
+  jay::network j1939_network{ "vcan0" };
+
+  // Engine, transmission and a second engine from another manufacturer
+  jay::name engine{ 0x1U, 0x100, 0, 0, 0x00, 0, 0, 2, false };
+  jay::name transmission{ 0x2U, 0x100, 0, 0, 0x03, 0, 0, 2, false };
+  jay::name engine_2{ 0x3U, 0x200, 0, 1, 0x00, 0, 0, 2, false };
+  j1939_network.insert(engine, 0x00);
+  j1939_network.insert(transmission, 0x03);
+  j1939_network.insert(engine_2, J1939_IDLE_ADDR);
+
+  ASSERT_EQ(j1939_network.find_names(field::function, 0x00).size(), 2U);
+  ASSERT_EQ(j1939_network.find_names(field::function, 0x03).size(), 1U);
+  ASSERT_EQ(j1939_network.find_names(field::manufacturer_code, 0x100).size(), 2U);
+  ASSERT_EQ(j1939_network.find_names(field::function_instance, 1).size(), 1U);
+  ASSERT_EQ(j1939_network.find_names(field::industry_group, 2).size(), 3U);
+  ASSERT_TRUE(j1939_network.find_names(field::device_class, 1).empty());
+
+  // Releasing keeps the name, removing it removes it from the index
+  j1939_network.release(transmission);
+  ASSERT_EQ(j1939_network.find_names(field::function, 0x03).size(), 1U);
+  j1939_network.remove(transmission);
+  ASSERT_TRUE(j1939_network.find_names(field::function, 0x03).empty());
+
+  std::size_t count{ 0 };
+  j1939_network.for_each_name(field::manufacturer_code, 0x200, [&count, &engine_2](jay::name name) {
+    ASSERT_EQ(name, engine_2);
+    count++;
+  });
+  ASSERT_EQ(count, 1U);
+
+  j1939_network.clear();
+  ASSERT_TRUE(j1939_network.find_names(field::industry_group, 2).empty());
+}
+
+TEST(Jay_Network_Test, Jay_Network_For_Each_Test)
+{
+  jay::network j1939_network{ "vcan0" };
+  j1939_network.insert(jay::name{ 1U }, 0x10);
+  j1939_network.insert(jay::name{ 2U }, 0x20);
+  j1939_network.insert(jay::name{ 3U }, J1939_IDLE_ADDR);
+
+  // Only the names are in the set
+  auto set = j1939_network.get_name_set();
+  ASSERT_EQ(set.size(), 3U);
+  ASSERT_EQ(set.count(jay::name{ 1U }), 1U);
+
+  std::size_t names{ 0 };
+  std::size_t idle{ 0 };
+  j1939_network.for_each([&](jay::name, std::uint8_t address) {
+    names++;
+    if (address == J1939_IDLE_ADDR) { idle++; }
+  });
+  ASSERT_EQ(names, 3U);
+  ASSERT_EQ(idle, 1U);
+
+  // Can modify the network as it is visited after the lock is released
+  j1939_network.for_each_address([&j1939_network](jay::name name, std::uint8_t address) {
+    ASSERT_EQ(j1939_network.get_address(name), address);
+    j1939_network.release(name);
+  });
+  ASSERT_EQ(j1939_network.address_count(), 0U);
+
+  std::array<jay::network::entry, 2> entries{};
+  ASSERT_EQ(j1939_network.export_entries(entries.data(), entries.size()), 3U);
+  std::array<jay::network::entry, 4> all{};
+  ASSERT_EQ(j1939_network.export_entries(all.data(), all.size()), 3U);
+  ASSERT_EQ(all[2].address, J1939_IDLE_ADDR);
+  ASSERT_EQ(all[3].name, jay::name{});
+}
@@ -0,0 +1,89 @@
+//
+// Copyright (c) 2022 Bjørn Fuglestad, Jaersense AS (bjorn@jaersense.no)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/bjorn-jaes/jay
+//
+
+#include <gtest/gtest.h>
+
+#include "../include/jay/pgn_codec.hpp"
+
+// C++
+#include <limits>
+
+namespace {
+
+// Electronic Engine Controller 1 (EEC1), PGN 61444
+using torque_mode = jay::spn<0, 4>;
+using driver_demand_torque = jay::spn<8, 8, std::ratio<1>, std::ratio<-125>>;
+using actual_torque = jay::spn<16, 8, std::ratio<1>, std::ratio<-125>>;
+using engine_speed = jay::spn<24, 16, std::ratio<1, 8>>;
+using source_address = jay::spn<40, 8>;
+
+using eec1 = jay::pgn_codec<0xF004, 3, torque_mode, driver_demand_torque, actual_torque, engine_speed, source_address>;
+
+}// namespace
+
+TEST(Jay_Pgn_Codec_Test, Jay_Pgn_Codec_Decode_Test)
+{
+  // Torque mode 1, demand 25%, actual 30%, 1200 rpm, from 0x00
+  jay::payload payload{ 0xF1, 0x96, 0x9B, 0x80, 0x25, 0x00, 0xFF, 0xFF };
+
+  auto values = eec1::decode(payload);
+  ASSERT_DOUBLE_EQ(values[eec1::index<torque_mode>], 1.0);
+  ASSERT_DOUBLE_EQ(values[eec1::index<driver_demand_torque>], 25.0);
+  ASSERT_DOUBLE_EQ(values[eec1::index<actual_torque>], 30.0);
+  ASSERT_DOUBLE_EQ(values[eec1::index<engine_speed>], 1200.0);
+  ASSERT_DOUBLE_EQ(values[eec1::index<source_address>], 0.0);
+
+  ASSERT_DOUBLE_EQ(eec1::get<engine_speed>(payload), 1200.0);
+  ASSERT_EQ(eec1::decode_raw(payload)[eec1::index<engine_speed>], 9600U);
+}
+
+TEST(Jay_Pgn_Codec_Test, Jay_Pgn_Codec_Encode_Test)
+{
+  auto payload = eec1::encode({ 1.0, 25.0, 30.0, 1200.0, 0.0 });
+  ASSERT_EQ(payload, (jay::payload{ 0xF1, 0x96, 0x9B, 0x80, 0x25, 0x00, 0xFF, 0xFF }));
+
+  // Values are rounded to the resolution and clamped to the range
+  ASSERT_EQ(eec1::decode(eec1::encode({ 1.0, -200.0, 300.0, 1200.06, 0.0 })),
+    (eec1::values{ 1.0, -125.0, 130.0, 1200.0, 0.0 }));
+
+  // NaN is encoded as not available
+  auto not_available = std::numeric_limits<double>::quiet_NaN();
+  ASSERT_EQ(eec1::decode_raw(eec1::encode({ not_available, 25.0, not_available, not_available, 0.0 })),
+    (eec1::raw_values{ 0xF, 150, 0xFF, 0xFFFF, 0x00 }));
+
+  auto frame = eec1::make_frame({ 1.0, 25.0, 30.0, 1200.0, 0.0 }, 0x00);
+  ASSERT_EQ(frame.header.pgn(), 0xF004U);
+  ASSERT_EQ(frame.header.priority(), 3);
+  ASSERT_EQ(frame.header.payload_length(), 8U);
+  ASSERT_EQ(frame.payload, payload);
+}
+
+TEST(Jay_Pgn_Codec_Test, Jay_Pgn_Codec_Constexpr_Test)
+{
+  constexpr jay::payload payload{ 0xF1, 0x96, 0x9B, 0x80, 0x25, 0x00, 0xFF, 0xFF };
+  static_assert(eec1::get<engine_speed>(payload) == 1200.0);
+  static_assert(jay::to_word(eec1::encode({ 1.0, 25.0, 30.0, 1200.0, 0.0 })) == jay::to_word(payload));
+  static_assert(eec1::make_frame({ 1.0, 25.0, 30.0, 1200.0, 0.0 }, 0x00).header.id() == 0x0CF00400);
+
+  // Peer-to-peer parameter groups get the destination in PS
+  using request = jay::pgn_codec<0xEA00, 6, jay::spn<0, 24>>;
+  static_assert(request::make_frame({ 0xEE00 }, 0x10, 0x20).header.pdu_specific() == 0x20);
+
+  static_assert(jay::spn<0, 64>::mask == ~0ULL);
+
+  // Wide SPNs saturate at the largest raw value below 2^Length instead of overflowing
+  static_assert(jay::spn<0, 64>::to_raw(1e30) == 0xFFFF'FFFF'FFFF'F800ULL);
+  static_assert(jay::spn<0, 63>::to_raw(1e30) == 0x7FFF'FFFF'FFFF'FC00ULL);
+  static_assert(jay::spn<4, 60>::to_raw(1e30) == 0x0FFF'FFFF'FFFF'FF80ULL);
+  static_assert(jay::spn<4, 60>::encode(0, 1e30) == 0xFFFF'FFFF'FFFF'F800ULL);
+  static_assert(jay::spn<0, 53>::to_raw(1e30) == jay::spn<0, 53>::mask);
+  static_assert(jay::spn<0, 64>::to_raw(-1.0) == 0);
+  static_assert(jay::to_word(jay::to_payload(0x0102030405060708ULL)) == 0x0102030405060708ULL);
+  ASSERT_EQ(eec1::used_mask, 0x0000'FFFF'FFFF'FF0FULL);
+}
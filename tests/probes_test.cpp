@@ -0,0 +1,96 @@
+//
+// Copyright (c) 2022 Bjørn Fuglestad, Jaersense AS (bjorn@jaersense.no)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/bjorn-jaes/jay
+//
+
+#include <gtest/gtest.h>
+
+#include "../include/jay/address_claimer.hpp"
+#include "../include/jay/network.hpp"
+#include "../include/jay/probes.hpp"
+
+// C++
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <set>
+#include <string>
+#include <vector>
+
+// Linux
+#include <elf.h>
+
+namespace {
+
+/**
+ * @brief List the probes in the stapsdt notes of an ELF64 file
+ * @param path to the ELF file
+ * @return set of "provider:name" strings
+ */
+std::set<std::string> list_probes(const std::string &path)
+{
+  std::ifstream file{ path, std::ios::binary };
+  std::vector<char> elf{ std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+  std::set<std::string> probes{};
+  if (elf.size() < sizeof(Elf64_Ehdr)) { return probes; }
+
+  Elf64_Ehdr header{};
+  std::memcpy(&header, elf.data(), sizeof(header));
+  if (std::memcmp(header.e_ident, ELFMAG, SELFMAG) != 0 || header.e_ident[EI_CLASS] != ELFCLASS64) { return probes; }
+
+  std::vector<Elf64_Shdr> sections(header.e_shnum);
+  std::memcpy(sections.data(), elf.data() + header.e_shoff, header.e_shnum * sizeof(Elf64_Shdr));
+  const char *section_names = elf.data() + sections[header.e_shstrndx].sh_offset;
+
+  for (auto &section : sections) {
+    if (section.sh_type != SHT_NOTE || std::strcmp(section_names + section.sh_name, ".note.stapsdt") != 0) {
+      continue;
+    }
+
+    auto offset = section.sh_offset;
+    auto end = section.sh_offset + section.sh_size;
+    while (offset + sizeof(Elf64_Nhdr) <= end) {
+      Elf64_Nhdr note{};
+      std::memcpy(&note, elf.data() + offset, sizeof(note));
+      auto name_offset = offset + sizeof(note);
+      auto desc_offset = name_offset + ((note.n_namesz + 3) & ~3U);
+      offset = desc_offset + ((note.n_descsz + 3) & ~3U);
+
+      // Description is pc, base and semaphore address followed by provider, name and arguments
+      if (note.n_type != 3 || std::strcmp(elf.data() + name_offset, "stapsdt") != 0) { continue; }
+      const char *provider = elf.data() + desc_offset + 3 * sizeof(std::uint64_t);
+      const char *probe = provider + std::strlen(provider) + 1;
+      probes.insert(std::string{ provider } + ":" + probe);
+    }
+  }
+  return probes;
+}
+
+}// namespace
+
+TEST(Jay_Probes_Test, Jay_Probes_Elf_Notes_Test)
+{
+#ifndef JAY_USDT
+  GTEST_SKIP() << "USDT probes are disabled, configure with -DJAY_USDT=ON";
+#endif
+
+  // Make sure the functions containing the probes are part of the binary
+  jay::network j1939_network{ "vcan0" };
+  j1939_network.insert(jay::name{ 0xFF }, 0x10);
+  j1939_network.release(jay::name{ 0xFF });
+  boost::sml::sm<jay::address_claimer> state_machine{ jay::address_claimer{ jay::name{ 0xFF } },
+    j1939_network,
+    jay::address_claimer::st_claiming{},
+    jay::address_claimer::st_has_address{} };
+  state_machine.process_event(jay::address_claimer::ev_start_claim{ 0x10 });
+
+  auto probes = list_probes("/proc/self/exe");
+  for (auto probe : { "network_insert", "network_release", "claim_begin", "claim_send", "cannot_claim",
+         "address_gain", "address_loss" }) {
+    EXPECT_TRUE(probes.count(std::string{ "jay:" } + probe)) << "Missing probe: jay:" << probe;
+  }
+}
@@ -0,0 +1,243 @@
+//
+// Copyright (c) 2022 Bjørn Fuglestad, Jaersense AS (bjorn@jaersense.no)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/bjorn-jaes/jay
+//
+
+#include <gtest/gtest.h>
+
+#include "../include/jay/request_manager.hpp"
+
+// C++
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Software identification and component identification
+constexpr pgn_t software_id{ 0xFEDA };
+constexpr pgn_t component_id{ 0xFEEB };
+
+}// namespace
+
+class RequestManagerTest : public testing::Test
+{
+protected:
+  RequestManagerTest()
+  {
+    j1939_network.insert(local_name, 0x80);
+    manager.set_callbacks(jay::request_manager::callbacks{
+      [this](jay::frame frame) -> void { sent.push_back(frame); }, [](auto, auto) -> void {} });
+  }
+
+  /**
+   * @brief Record the outcome of a request
+   */
+  jay::request_manager::handler record()
+  {
+    return [this](auto result, auto frame) -> void { results.push_back({ result, frame }); };
+  }
+
+  static jay::frame make_response(pgn_t pgn, std::uint8_t source_address)
+  {
+    return jay::frame{ jay::frame_header{ 6, pgn, source_address, 8 }, { 1, 2, 3, 4, 5, 6, 7, 8 } };
+  }
+
+public:
+  jay::name local_name{ 0xA00U };
+  boost::asio::io_context context{};
+  jay::network j1939_network{ "vcan0" };
+  jay::request_manager manager{ context, local_name, j1939_network };
+
+  std::vector<jay::frame> sent{};
+  std::vector<std::pair<jay::request_manager::status, jay::frame>> results{};
+};
+
+TEST_F(RequestManagerTest, Jay_Request_Manager_Response_Test)
+{
+  manager.request(software_id, 0x21, record());
+  context.poll();
+  ASSERT_EQ(sent.size(), 1U);
+  ASSERT_TRUE(sent[0].header.is_request());
+  ASSERT_EQ(sent[0].header.pdu_specific(), 0x21);
+  ASSERT_EQ(sent[0].header.source_adderess(), 0x80);
+  ASSERT_EQ(sent[0].payload[0], 0xDA);
+  ASSERT_EQ(sent[0].payload[1], 0xFE);
+
+  // Other PGNs and other source addresses are not responses
+  manager.process(make_response(component_id, 0x21));
+  manager.process(make_response(software_id, 0x22));
+  context.poll();
+  ASSERT_TRUE(results.empty());
+
+  manager.process(make_response(software_id, 0x21));
+  context.poll();
+  ASSERT_EQ(results.size(), 1U);
+  ASSERT_EQ(results[0].first, jay::request_manager::status::response);
+  ASSERT_EQ(results[0].second.header.source_adderess(), 0x21);
+
+  auto stats = manager.get_stats();
+  ASSERT_EQ(stats.requests, 1U);
+  ASSERT_EQ(stats.sent, 1U);
+  ASSERT_EQ(stats.responses, 1U);
+}
+
+TEST_F(RequestManagerTest, Jay_Request_Manager_Coalesce_Test)
+{
+  manager.request(software_id, 0x21, record());
+  manager.request(software_id, 0x21, record());
+  manager.request(software_id, 0x22, record());
+  context.poll();
+  ASSERT_EQ(sent.size(), 2U);
+
+  manager.process(make_response(software_id, 0x21));
+  context.poll();
+  ASSERT_EQ(results.size(), 2U);
+
+  // Global requests complete on the first response
+  manager.request(component_id, J1939_NO_ADDR, record());
+  context.poll();
+  manager.process(make_response(component_id, 0x30));
+  context.poll();
+  ASSERT_EQ(results.size(), 3U);
+  ASSERT_EQ(results[2].second.header.source_adderess(), 0x30);
+
+  auto stats = manager.get_stats();
+  ASSERT_EQ(stats.requests, 4U);
+  ASSERT_EQ(stats.sent, 3U);
+  ASSERT_EQ(stats.coalesced, 1U);
+}
+
+TEST_F(RequestManagerTest, Jay_Request_Manager_Timeout_Test)
+{
+  using namespace std::chrono_literals;
+
+  // Shared timer is moved forward for the shorter timeout
+  manager.request(software_id, 0x21, record(), 200ms);
+  manager.request(software_id, 0x22, record(), 20ms);
+  context.run_for(100ms);
+  ASSERT_EQ(results.size(), 1U);
+  ASSERT_EQ(results[0].first, jay::request_manager::status::timeout);
+
+  context.restart();
+  context.run_for(200ms);
+  ASSERT_EQ(results.size(), 2U);
+  ASSERT_EQ(results[1].first, jay::request_manager::status::timeout);
+
+  // Late responses are ignored
+  manager.process(make_response(software_id, 0x21));
+  context.restart();
+  context.poll();
+  ASSERT_EQ(results.size(), 2U);
+  ASSERT_EQ(manager.get_stats().timeouts, 2U);
+}
+
+TEST_F(RequestManagerTest, Jay_Request_Manager_Cache_Test)
+{
+  using namespace std::chrono_literals;
+
+  manager.cache(component_id, 50ms);
+  manager.request(component_id, 0x21, record());
+  context.poll();
+  manager.process(make_response(component_id, 0x21));
+  context.poll();
+  ASSERT_EQ(sent.size(), 1U);
+  ASSERT_EQ(results.size(), 1U);
+
+  // Served from the cache until the TTL expires
+  manager.request(component_id, 0x21, record());
+  context.poll();
+  ASSERT_EQ(sent.size(), 1U);
+  ASSERT_EQ(results.size(), 2U);
+  ASSERT_EQ(results[1].first, jay::request_manager::status::response);
+  ASSERT_EQ(manager.get_stats().cache_hits, 1U);
+
+  std::this_thread::sleep_for(60ms);
+  manager.request(component_id, 0x21, record());
+  context.poll();
+  ASSERT_EQ(sent.size(), 2U);
+}
+
+TEST_F(RequestManagerTest, Jay_Request_Manager_Cache_Global_Test)
+{
+  using namespace std::chrono_literals;
+
+  // A response is cached for its source address and for global requests
+  manager.cache(component_id, 50ms);
+  manager.request(component_id, 0x21, record());
+  context.poll();
+  manager.process(make_response(component_id, 0x21));
+  context.poll();
+  ASSERT_EQ(manager.get_stats().cached, 2U);
+
+  manager.request(component_id, J1939_NO_ADDR, record());
+  context.poll();
+  ASSERT_EQ(sent.size(), 1U);
+  ASSERT_EQ(results.size(), 2U);
+  ASSERT_EQ(results[1].first, jay::request_manager::status::response);
+  ASSERT_EQ(results[1].second.header.source_adderess(), 0x21);
+
+  // Expired responses are evicted on lookup
+  std::this_thread::sleep_for(60ms);
+  manager.request(component_id, J1939_NO_ADDR, record(), 10ms);
+  context.poll();
+  ASSERT_EQ(sent.size(), 2U);
+  ASSERT_EQ(manager.get_stats().cached, 1U);
+
+  // And when requests time out
+  context.run_for(50ms);
+  ASSERT_EQ(results.size(), 3U);
+  ASSERT_EQ(results[2].first, jay::request_manager::status::timeout);
+  ASSERT_EQ(manager.get_stats().cached, 0U);
+}
+
+TEST_F(RequestManagerTest, Jay_Request_Manager_No_Address_Test)
+{
+  j1939_network.release(local_name);
+  manager.request(software_id, 0x21, record());
+  context.poll();
+  ASSERT_TRUE(sent.empty());
+  ASSERT_EQ(results.size(), 1U);
+  ASSERT_EQ(results[0].first, jay::request_manager::status::no_address);
+}
+
+TEST_F(RequestManagerTest, Jay_Request_Manager_Acknowledgement_Test)
+{
+  using namespace std::chrono_literals;
+
+  manager.request(software_id, 0x21, record(), 10s);
+  manager.request(component_id, 0x21, record(), 10s);
+  context.poll();
+
+  // Acknowledgements to other controllers, for other PGNs or from other controllers are ignored
+  manager.process(jay::frame::make_acknowledgement(jay::ACK_NEGATIVE, software_id, 0x81, 0x21));
+  manager.process(jay::frame::make_acknowledgement(jay::ACK_NEGATIVE, 0xFEDB, 0x80, 0x21));
+  manager.process(jay::frame::make_acknowledgement(jay::ACK_NEGATIVE, software_id, 0x80, 0x22));
+  context.poll();
+  ASSERT_TRUE(results.empty());
+
+  // Completes without waiting for the timeout
+  manager.process(jay::frame::make_acknowledgement(jay::ACK_NEGATIVE, software_id, 0x80, 0x21));
+  manager.process(jay::frame::make_acknowledgement(jay::ACK_ACCESS_DENIED, component_id, 0x80, 0x21));
+  context.poll();
+  ASSERT_EQ(results.size(), 2U);
+  ASSERT_EQ(results[0].first, jay::request_manager::status::not_acknowledged);
+  ASSERT_TRUE(results[0].second.header.is_acknowledgement());
+  ASSERT_EQ(results[1].first, jay::request_manager::status::access_denied);
+
+  auto counts = manager.get_acknowledgements(0x21);
+  ASSERT_EQ(counts.acknowledged, 0U);
+  ASSERT_EQ(counts.not_acknowledged, 1U);
+  ASSERT_EQ(counts.access_denied, 1U);
+  ASSERT_EQ(counts.cannot_respond, 0U);
+  ASSERT_EQ(manager.get_acknowledgements(0x22).not_acknowledged, 0U);
+
+  auto stats = manager.get_stats();
+  ASSERT_EQ(stats.acknowledgements, 2U);
+  ASSERT_EQ(stats.responses, 0U);
+  ASSERT_EQ(stats.timeouts, 0U);
+}
@@ -0,0 +1,153 @@
+//
+// Copyright (c) 2022 Bjørn Fuglestad, Jaersense AS (bjorn@jaersense.no)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/bjorn-jaes/jay
+//
+
+#include <gtest/gtest.h>
+
+#include "../include/jay/signal_database.hpp"
+
+// C++
+#include <sstream>
+
+namespace {
+
+const char *dbc = R"(VERSION ""
+
+NS_ :
+  CM_
+  BA_
+
+BU_: Engine Brake
+
+BO_ 2364540158 EEC1: 8 Engine
+ SG_ EngineTorqueMode : 0|4@1+ (1,0) [0|15] "" Brake
+ SG_ DriverDemandTorque : 8|8@1+ (1,-125) [-125|125] "%" Brake
+ SG_ ActualTorque : 16|8@1+ (1,-125) [-125|125] "%" Brake
+ SG_ EngineSpeed : 24|16@1+ (0.125,0) [0|8031.875] "rpm" Brake
+ SG_ SourceAddress : 40|8@1+ (1,0) [0|255] "" Brake
+
+BO_ 2364539915 EEC1_Other: 8 Brake
+ SG_ Ignored : 0|8@1+ (1,0) [0|255] "" Engine
+
+BO_ 2565817086 ProprietaryA: 8 Engine
+ SG_ Signed : 0|16@1- (0.5,0) [-16384|16383.5] "Nm" Brake
+ SG_ Flag : 63|1@1+ (1,0) [0|1] "" Brake
+
+CM_ SG_ 2364540158 EngineSpeed "Actual engine speed";
+BA_ "SPN" SG_ 2364540158 EngineSpeed 190;
+)";
+
+jay::signal_database load(const std::string &text)
+{
+  std::istringstream stream{ text };
+  return jay::signal_database::load(stream);
+}
+
+}// namespace
+
+TEST(Jay_Signal_Database_Test, Jay_Signal_Database_Load_Test)
+{
+  auto database = load(dbc);
+  ASSERT_EQ(database.message_count(), 2U);
+  ASSERT_EQ(database.signals().size(), 7U);
+  ASSERT_EQ(database.max_signals(), 5U);
+
+  auto *eec1 = database.find(0xF004);
+  ASSERT_NE(eec1, nullptr);
+  ASSERT_EQ(eec1->count, 5U);
+
+  auto &speed = database.signals()[eec1->first + 3];
+  ASSERT_EQ(speed.name, "EngineSpeed");
+  ASSERT_EQ(speed.message, "EEC1");
+  ASSERT_EQ(speed.unit, "rpm");
+  ASSERT_EQ(speed.pgn, 0xF004U);
+  ASSERT_EQ(speed.start_bit, 24);
+  ASSERT_EQ(speed.length, 16);
+  ASSERT_FALSE(speed.is_signed);
+  ASSERT_DOUBLE_EQ(speed.scale, 0.125);
+  ASSERT_DOUBLE_EQ(speed.maximum, 8031.875);
+
+  // Peer-to-peer PGN, destination address in the id is not part of the PGN
+  ASSERT_NE(database.find(0xEF00), nullptr);
+  ASSERT_EQ(database.find(0xEF12), nullptr);
+  ASSERT_EQ(database.find(0xFEF1), nullptr);
+  ASSERT_EQ(database.find(0x3FFFF), nullptr);
+  ASSERT_EQ(database.find(0x40000), nullptr);
+}
+
+TEST(Jay_Signal_Database_Test, Jay_Signal_Database_Decode_Test)
+{
+  auto database = load(dbc);
+  std::vector<double> values(database.max_signals());
+
+  // Torque mode 1, demand 25%, actual 30%, 1200 rpm, from 0x00
+  jay::frame eec1{ jay::frame_header{ 3, 0xF004, 0x00, 8 }, { 0xF1, 0x96, 0x9B, 0x80, 0x25, 0x00, 0xFF, 0xFF } };
+  auto *program = database.decode(eec1, values.data());
+  ASSERT_NE(program, nullptr);
+  ASSERT_EQ(program->count, 5U);
+  ASSERT_DOUBLE_EQ(values[0], 1.0);
+  ASSERT_DOUBLE_EQ(values[1], 25.0);
+  ASSERT_DOUBLE_EQ(values[2], 30.0);
+  ASSERT_DOUBLE_EQ(values[3], 1200.0);
+  ASSERT_DOUBLE_EQ(values[4], 0.0);
+
+  // Same program regardless of destination address and source address
+  jay::frame proprietary{ jay::frame_header{ 6, 0xEF00, 0x80, 8 }, { 0xFE, 0xFF, 0, 0, 0, 0, 0, 0x80 } };
+  proprietary.header.pdu_specific(0x42);
+  program = database.decode(proprietary, values.data());
+  ASSERT_NE(program, nullptr);
+  ASSERT_EQ(database.signals()[program->first].name, "Signed");
+  ASSERT_DOUBLE_EQ(values[0], -1.0);
+  ASSERT_DOUBLE_EQ(values[1], 1.0);
+
+  jay::frame unknown{ jay::frame_header{ 6, 0xFEF1, 0x00, 8 }, {} };
+  ASSERT_EQ(database.decode(unknown, values.data()), nullptr);
+}
+
+TEST(Jay_Signal_Database_Test, Jay_Signal_Database_Error_Test)
+{
+  ASSERT_EQ(load("").message_count(), 0U);
+  ASSERT_THROW(load("BO_ 2364540158 EEC1 8 Engine"), std::invalid_argument);
+  ASSERT_THROW(load(" SG_ Orphan : 0|8@1+ (1,0) [0|255] \"\" Brake"), std::invalid_argument);
+  ASSERT_THROW(load("BO_ 2364540158 EEC1: 8 Engine\n SG_ Mux X : 0|8@1+ (1,0) [0|255] \"\" Brake"),
+    std::invalid_argument);
+  ASSERT_THROW(load("BO_ 2364540158 EEC1: 8 Engine\n SG_ Empty : 0|0@1+ (1,0) [0|255] \"\" Brake"),
+    std::invalid_argument);
+  ASSERT_THROW(load("BO_ 2364540158 EEC1: 8 Engine\n SG_ Bad : 0|8@1+ 1,0 [0|255] \"\" Brake"),
+    std::invalid_argument);
+  ASSERT_THROW(jay::signal_database::load_file("/nonexistent/database.dbc"), std::invalid_argument);
+}
+
+TEST(Jay_Signal_Database_Test, Jay_Signal_Database_Mixed_Test)
+{
+  // Unsupported definitions are skipped and counted, the rest of the file is still loaded
+  auto database = load(R"(BO_ 3221225472 VECTOR__INDEPENDENT_SIG_MSG: 0 Vector__XXX
+ SG_ Unused : 0|8@1+ (1,0) [0|255] "" Vector__XXX
+
+BO_ 2024 DiagResponse: 8 Engine
+ SG_ Service : 8|8@1+ (1,0) [0|255] "" Tester
+
+BO_ 2364540158 EEC1: 8 Engine
+ SG_ EngineSpeed : 24|16@1+ (0.125,0) [0|8031.875] "rpm" Brake
+ SG_ Big : 7|8@0+ (1,0) [0|255] "" Brake
+ SG_ Wide : 60|8@1+ (1,0) [0|255] "" Brake
+
+BO_ 2565817086 ProprietaryA: 8 Engine
+ SG_ Mux M : 0|8@1+ (1,0) [0|255] "" Brake
+ SG_ Value m0 : 8|8@1+ (1,0) [0|255] "" Brake
+ SG_ Other m1 : 8|16@1+ (1,0) [0|65535] "" Brake
+)");
+  ASSERT_EQ(database.message_count(), 2U);
+  ASSERT_EQ(database.skipped_messages(), 2U);
+  ASSERT_EQ(database.skipped_signals(), 6U);
+  ASSERT_EQ(database.signals().size(), 2U);
+  ASSERT_EQ(database.signals()[0].name, "EngineSpeed");
+  ASSERT_EQ(database.signals()[1].name, "Mux");
+  ASSERT_NE(database.find(0xF004), nullptr);
+  ASSERT_NE(database.find(0xEF00), nullptr);
+}
@@ -0,0 +1,121 @@
+//
+// Copyright (c) 2022 Bjørn Fuglestad, Jaersense AS (bjorn@jaersense.no)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/bjorn-jaes/jay
+//
+
+#include <gtest/gtest.h>
+
+#include "../include/jay/spn_columns.hpp"
+
+// C++
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace {
+
+jay::frame_columns make_columns(const std::vector<jay::frame> &frames)
+{
+  jay::frame_columns columns{};
+  jay::decode_columns(frames.data(), frames.size(), columns);
+  return columns;
+}
+
+jay::frame make_frame(pgn_t pgn, std::uint64_t word)
+{
+  return jay::frame{ jay::frame_header{ 6, pgn, 0x80, 8 }, jay::to_payload(word) };
+}
+
+}// namespace
+
+TEST(Jay_Spn_Columns_Test, Jay_Spn_Valid_Max_Test)
+{
+  ASSERT_EQ(jay::spn_valid_max(1), 0x1U);
+  ASSERT_EQ(jay::spn_valid_max(2), 0x1U);
+  ASSERT_EQ(jay::spn_valid_max(4), 0xDU);
+  ASSERT_EQ(jay::spn_valid_max(8), 0xFAU);
+  ASSERT_EQ(jay::spn_valid_max(16), 0xFAFFU);
+  ASSERT_EQ(jay::spn_valid_max(32), 0xFAFF'FFFFU);
+  ASSERT_EQ(jay::spn_valid_max(64), 0xFAFF'FFFF'FFFF'FFFFU);
+}
+
+TEST(Jay_Spn_Columns_Test, Jay_Spn_Columns_Scale_Test)
+{
+  // Engine speed, 0.125 rpm/bit in bytes 4 - 5
+  const jay::spn_scaling speed{ 24, 16, 0.125, 0.0 };
+  std::vector<jay::frame> frames{ make_frame(0xF004, 0x0000'0025'8000'0000),
+    make_frame(0xF004, 0x0000'00FA'FF00'0000),
+    make_frame(0xF004, 0x0000'00FB'0000'0000),
+    make_frame(0xF004, 0x0000'00FE'1200'0000),
+    make_frame(0xF004, 0x0000'00FF'FF00'0000),
+    make_frame(0xFEF1, 0x0000'0025'8000'0000) };
+  auto columns = make_columns(frames);
+
+  std::vector<double> values(columns.size());
+  jay::scale_column(columns, speed, values.data());
+  ASSERT_DOUBLE_EQ(values[0], 1200.0);
+  ASSERT_DOUBLE_EQ(values[1], 8031.875);
+  ASSERT_TRUE(std::isnan(values[2]));
+  ASSERT_TRUE(std::isnan(values[3]));
+  ASSERT_TRUE(std::isnan(values[4]));
+  ASSERT_DOUBLE_EQ(values[5], 1200.0);
+
+  // Rows of other PGNs are not available
+  std::vector<float> floats(columns.size());
+  jay::scale_column(columns, 0xF004, speed, floats.data());
+  ASSERT_FLOAT_EQ(floats[0], 1200.0F);
+  ASSERT_FLOAT_EQ(floats[1], 8031.875F);
+  ASSERT_TRUE(std::isnan(floats[4]));
+  ASSERT_TRUE(std::isnan(floats[5]));
+
+  // Offset and discrete SPNs
+  jay::scale_column(columns, jay::spn_scaling{ 24, 8, 1.0, -125.0 }, values.data());
+  ASSERT_DOUBLE_EQ(values[0], 3.0);
+  jay::scale_column(columns, jay::spn_scaling{ 32, 2 }, values.data());
+  ASSERT_DOUBLE_EQ(values[0], 1.0);
+  ASSERT_TRUE(std::isnan(values[3]));
+  ASSERT_TRUE(std::isnan(values[4]));
+
+  using engine_speed = jay::spn<24, 16, std::ratio<1, 8>>;
+  jay::scale_column(columns, jay::spn_scaling::of<engine_speed>(), values.data());
+  ASSERT_DOUBLE_EQ(values[0], 1200.0);
+}
+
+TEST(Jay_Spn_Columns_Test, Jay_Spn_Columns_Scalar_Test)
+{
+  // Vector and scalar paths must give the same result for every length and row count
+  std::mt19937_64 generator{ 1939 };
+  for (std::size_t count : { 1, 3, 4, 5, 8, 17, 1001 }) {
+    std::vector<jay::frame> frames{};
+    for (std::size_t i = 0; i < count; i++) {
+      auto word = generator();
+      // Make sentinels common
+      if (i % 3 == 0) { word |= 0xFF00'FF00'FF00'FF00U; }
+      frames.push_back(make_frame(i % 2 == 0 ? 0xF004 : 0xFEF1, word));
+    }
+    auto columns = make_columns(frames);
+
+    for (std::uint8_t length : { 1, 2, 4, 8, 12, 16, 32, 52, 53, 64 }) {
+      jay::spn_scaling spn{ static_cast<std::uint8_t>(64 - length), length, 0.05, -40.0 };
+      std::vector<double> expected(count);
+      std::vector<double> values(count);
+      std::vector<float> floats(count);
+      jay::scale_column_scalar(columns, 0xF004, spn, expected.data());
+      jay::scale_column(columns, 0xF004, spn, values.data());
+      jay::scale_column(columns, 0xF004, spn, floats.data());
+      for (std::size_t i = 0; i < count; i++) {
+        if (std::isnan(expected[i])) {
+          ASSERT_TRUE(std::isnan(values[i])) << count << " " << int{ length } << " " << i;
+          ASSERT_TRUE(std::isnan(floats[i])) << count << " " << int{ length } << " " << i;
+        } else {
+          ASSERT_EQ(values[i], expected[i]) << count << " " << int{ length } << " " << i;
+          ASSERT_EQ(floats[i], static_cast<float>(expected[i])) << count << " " << int{ length } << " " << i;
+        }
+      }
+    }
+  }
+}
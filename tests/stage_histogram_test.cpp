@@ -0,0 +1,95 @@
+//
+// Copyright (c) 2022 Bjørn Fuglestad, Jaersense AS (bjorn@jaersense.no)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/bjorn-jaes/jay
+//
+
+#include <gtest/gtest.h>
+
+#include "../include/jay/stage_histogram.hpp"
+
+// C++
+#include <memory>
+#include <thread>
+#include <vector>
+
+TEST(Jay_Stage_Histogram_Test, Jay_Latency_Histogram_Bucket_Test)
+{
+  // Small values are exact
+  for (std::uint64_t value = 0; value < 2 * jay::latency_histogram::sub_bucket_count; value++) {
+    ASSERT_EQ(jay::latency_histogram::index(value), value);
+    ASSERT_EQ(jay::latency_histogram::highest_equivalent(value), value);
+  }
+
+  // Larger values are within the relative error of their bucket
+  for (std::uint64_t value = 64; value < 100'000'000; value = value * 3 / 2 + 1) {
+    auto index = jay::latency_histogram::index(value);
+    auto highest = jay::latency_histogram::highest_equivalent(index);
+    ASSERT_GE(highest, value);
+    ASSERT_LE(highest - value, value / jay::latency_histogram::sub_bucket_count);
+    ASSERT_GT(value, jay::latency_histogram::highest_equivalent(index - 1));
+  }
+
+  // Values above max are clamped into the last bucket
+  ASSERT_EQ(jay::latency_histogram::index(~0ULL), jay::latency_histogram::bucket_count - 1);
+  ASSERT_EQ(jay::latency_histogram::highest_equivalent(jay::latency_histogram::bucket_count - 1),
+    jay::latency_histogram::max_value);
+}
+
+TEST(Jay_Stage_Histogram_Test, Jay_Latency_Histogram_Percentile_Test)
+{
+  auto histogram = std::make_unique<jay::latency_histogram>();
+  ASSERT_EQ(histogram->count(), 0);
+  ASSERT_EQ(histogram->percentile(50.0), 0);
+
+  for (std::uint64_t value = 1; value <= 100; value++) { histogram->record(std::chrono::microseconds{ value }); }
+  histogram->record(std::chrono::nanoseconds{ -5 });// Clamped to 0
+
+  auto summary = histogram->summarize();
+  ASSERT_EQ(summary.count, 101);
+  ASSERT_EQ(summary.max, std::chrono::microseconds{ 100 });
+  ASSERT_NEAR(summary.p50.count(), 50'000, 50'000 / 32);
+  ASSERT_NEAR(summary.p99.count(), 99'000, 99'000 / 32);
+  ASSERT_EQ(histogram->percentile(0.0), 0);
+  ASSERT_EQ(histogram->percentile(100.0), 100'000);
+
+  auto other = std::make_unique<jay::latency_histogram>();
+  other->record(std::chrono::milliseconds{ 5 });
+  histogram->merge(*other);
+  ASSERT_EQ(histogram->count(), 102);
+  ASSERT_EQ(histogram->max(), 5'000'000);
+
+  histogram->reset();
+  ASSERT_EQ(histogram->count(), 0);
+  ASSERT_EQ(histogram->max(), 0);
+}
+
+TEST(Jay_Stage_Histogram_Test, Jay_Stage_Histograms_Thread_Test)
+{
+  jay::stage_histograms::reset();
+
+  std::vector<std::thread> threads{};
+  for (std::uint64_t i = 1; i <= 4; i++) {
+    threads.emplace_back([i]() {
+      for (int j = 0; j < 1000; j++) {
+        jay::stage_histograms::record(jay::stage::network_process, std::chrono::microseconds{ i });
+      }
+    });
+  }
+  for (auto &thread : threads) { thread.join(); }
+
+  auto snapshot = jay::stage_histograms::snapshot();
+  auto &process = snapshot[static_cast<std::size_t>(jay::stage::network_process)];
+  ASSERT_EQ(process.count, 4000);
+  ASSERT_EQ(process.max, std::chrono::microseconds{ 4 });
+  ASSERT_NEAR(process.p50.count(), 2'000, 2'000 / 32);
+  ASSERT_NEAR(process.p99.count(), 4'000, 4'000 / 32);
+  ASSERT_EQ(snapshot[static_cast<std::size_t>(jay::stage::user_callback)].count, 0);
+
+  jay::stage_histograms::reset();
+  snapshot = jay::stage_histograms::snapshot();
+  ASSERT_EQ(snapshot[static_cast<std::size_t>(jay::stage::network_process)].count, 0);
+}
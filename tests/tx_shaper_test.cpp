@@ -0,0 +1,91 @@
+//
+// Copyright (c) 2022 Bjørn Fuglestad, Jaersense AS (bjorn@jaersense.no)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/bjorn-jaes/jay
+//
+
+#include <gtest/gtest.h>
+
+#include "../include/jay/tx_shaper.hpp"
+
+// C++
+#include <chrono>
+
+namespace {
+
+// 147 bits on the bus
+const jay::frame ccvs{ jay::frame_header{ 0x18'FE'F1'00, 8 }, {} };
+
+// 134 bits on the bus
+const jay::frame eec1{ jay::frame_header{ 0x0C'F0'04'00, 8 }, { 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55 } };
+
+}// namespace
+
+TEST(Jay_Tx_Shaper_Test, Jay_Tx_Shaper_Priority_Test)
+{
+  using namespace std::chrono_literals;
+
+  jay::tx_shaper shaper{};
+  shaper.limit_priority(6, 14700, 2 * 147);
+  auto start = jay::tx_shaper::clock::time_point{ 10s };
+
+  // Burst of two frames, then one frame every 10 ms
+  ASSERT_TRUE(shaper.try_send(ccvs, start));
+  ASSERT_TRUE(shaper.try_send(ccvs, start));
+  ASSERT_FALSE(shaper.try_send(ccvs, start));
+  ASSERT_EQ(shaper.wait(ccvs, start), 10ms);
+  ASSERT_FALSE(shaper.try_send(ccvs, start + 5ms));
+  ASSERT_EQ(shaper.wait(ccvs, start + 5ms), 5ms);
+  ASSERT_TRUE(shaper.try_send(ccvs, start + 10ms));
+
+  // Other priorities are not limited
+  for (int i = 0; i < 10; i++) { ASSERT_TRUE(shaper.try_send(eec1, start + 10ms)); }
+  ASSERT_EQ(shaper.wait(eec1, start + 10ms), 0ms);
+}
+
+TEST(Jay_Tx_Shaper_Test, Jay_Tx_Shaper_Pgn_Test)
+{
+  using namespace std::chrono_literals;
+
+  jay::tx_shaper shaper{};
+  shaper.limit_priority(6, 1'000'000);
+  shaper.limit_pgn(0xFEF1, 1470, 0);
+  auto start = jay::tx_shaper::clock::time_point{ 10s };
+
+  // Burst is at least one frame, 13 bits are left after the first
+  ASSERT_TRUE(shaper.try_send(ccvs, start));
+  ASSERT_FALSE(shaper.try_send(ccvs, start + 50ms));
+  auto wait = shaper.wait(ccvs, start + 50ms);
+  ASSERT_GT(wait, 41ms);
+  ASSERT_LT(wait, 42ms);
+
+  // A frame that does not conform is not charged to its priority
+  jay::frame other{ jay::frame_header{ 0x18'FE'F2'00, 8 }, {} };
+  ASSERT_TRUE(shaper.try_send(other, start + 50ms));
+
+  ASSERT_TRUE(shaper.try_send(ccvs, start + 50ms + wait));
+  ASSERT_FALSE(shaper.try_send(ccvs, start + 50ms + wait));
+
+  shaper.limit_pgn(0xFEF1, 0);
+  ASSERT_TRUE(shaper.try_send(ccvs, start + 50ms + wait));
+}
+
+TEST(Jay_Tx_Shaper_Test, Jay_Tx_Shaper_Stats_Test)
+{
+  using namespace std::chrono_literals;
+
+  jay::tx_shaper shaper{};
+  shaper.record_conforming();
+  shaper.record_deferral(6, 10ms);
+  shaper.record_deferral(6, 30ms);
+
+  auto stats = shaper.get_stats();
+  ASSERT_EQ(stats.conforming, 1U);
+  ASSERT_EQ(stats.priority[6].count, 2U);
+  ASSERT_EQ(stats.priority[6].mean(), 20ms);
+  ASSERT_EQ(stats.priority[6].max, 30ms);
+  ASSERT_EQ(stats.priority[3].count, 0U);
+}